@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// blocksizecheck - Output must not depend on the host block size
+//
+// Renders the same input through two DelayBuffers, one fed 32-sample host
+// blocks and one 65536-sample blocks, and compares the outputs with
+// memcmp. Run for the realtime and offline sub-block sizes at several
+// host and internal rates, with float and packed lines. The input ends
+// in a mono stretch so the identical-channel path is split the same way.
+// Exits non-zero on any difference.
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Yonie;
+
+namespace {
+
+constexpr uint64_t kNoiseSeed = 0x5EED5EED5EED5EEDull;
+constexpr int kSmallBlock = 32;
+constexpr int kLargeBlock = 65536;
+constexpr int kNumSamples = 4 * kLargeBlock + 1234;  // ends on a partial block
+constexpr int kMaxDelayMs = 1000;
+constexpr int kDelayMs = 400;
+constexpr double kTwoPi = 6.283185307179586;
+
+const double kHostRates[] = { 44100.0, 48000.0, 96000.0 };
+const int kChunkSizes[] = { DelayBuffer::REALTIME_CHUNK_SIZE, DelayBuffer::OFFLINE_CHUNK_SIZE };
+
+//------------------------------------------------------------------------
+void fillInput(std::vector<float>& left, std::vector<float>& right, double sampleRate)
+{
+    uint32_t state = 777;
+    int monoFrom = kNumSamples * 3 / 4;
+    for (int i = 0; i < kNumSamples; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        float noise = static_cast<float>(state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        double t = i / sampleRate;
+        left[i] = 0.5f * static_cast<float>(std::sin(kTwoPi * 440.0 * t)) + 0.1f * noise;
+        right[i] = i < monoFrom ? 0.4f * static_cast<float>(std::sin(kTwoPi * 1234.5 * t)) : left[i];
+    }
+}
+
+//------------------------------------------------------------------------
+void render(const std::vector<float>& inL, const std::vector<float>& inR,
+            std::vector<float>& outL, std::vector<float>& outR,
+            double sampleRate, int rateIndex, int chunkSize, bool packed, int blockSize)
+{
+    DelayBuffer buffer;
+    buffer.setNoiseSeed(kNoiseSeed);
+    buffer.setChunkSize(chunkSize);
+    buffer.setLineFormat(packed ? DelayBuffer::LineFormat::Packed12 : DelayBuffer::LineFormat::Float32);
+    buffer.setInternalRate(rateIndex);
+    buffer.prepare(sampleRate, kMaxDelayMs);
+
+    for (int offset = 0; offset < kNumSamples; offset += blockSize)
+    {
+        int count = std::min(blockSize, kNumSamples - offset);
+        buffer.processStereo(inL.data() + offset, outL.data() + offset,
+                             inR.data() + offset, outR.data() + offset, count, kDelayMs);
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main()
+{
+    std::vector<float> inL(kNumSamples), inR(kNumSamples);
+    std::vector<float> smallL(kNumSamples), smallR(kNumSamples);
+    std::vector<float> largeL(kNumSamples), largeR(kNumSamples);
+
+    int settings = 0;
+    int failures = 0;
+    for (double sampleRate : kHostRates)
+    {
+        fillInput(inL, inR, sampleRate);
+        for (int rateIndex = 0; rateIndex < DelayBuffer::NUM_INTERNAL_RATES; ++rateIndex)
+            for (int chunkSize : kChunkSizes)
+                for (int packed = 0; packed < 2; ++packed)
+                {
+                    render(inL, inR, smallL, smallR, sampleRate, rateIndex, chunkSize, packed != 0, kSmallBlock);
+                    render(inL, inR, largeL, largeR, sampleRate, rateIndex, chunkSize, packed != 0, kLargeBlock);
+
+                    size_t bytes = kNumSamples * sizeof(float);
+                    bool same = std::memcmp(smallL.data(), largeL.data(), bytes) == 0
+                             && std::memcmp(smallR.data(), largeR.data(), bytes) == 0;
+                    if (!same)
+                    {
+                        int first = 0;
+                        while (smallL[first] == largeL[first] && smallR[first] == largeR[first])
+                            ++first;
+                        std::printf("FAILED %6.0f Hz -> %5.0f Hz, chunk %d, %s line: "
+                                    "%d- vs %d-sample blocks differ from sample %d\n",
+                                    sampleRate, DelayBuffer::INTERNAL_RATES[rateIndex], chunkSize,
+                                    packed ? "packed" : "float", kSmallBlock, kLargeBlock, first);
+                        ++failures;
+                    }
+                    ++settings;
+                }
+    }
+
+    std::printf("%d of %d settings identical for %d- and %d-sample blocks\n",
+                settings - failures, settings, kSmallBlock, kLargeBlock);
+    return failures == 0 ? 0 : 1;
+}
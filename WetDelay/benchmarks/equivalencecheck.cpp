@@ -0,0 +1,282 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// equivalencecheck - DelayBuffer against the plain reference model
+//
+// Renders randomized scenarios through DelayBuffer and ReferenceDelay and
+// compares them sample by sample. Each scenario picks a host rate (common
+// ones, and odd ones that get no resampler tables), internal rate, line
+// format, chunk size and bit depth, then plays signal segments (tones,
+// noise, silence, impulses, identical channels, overs, DC) in random block
+// sizes while changing delay time, tier, bit depth and now and then the
+// internal rate between blocks.
+//
+// Where the rate ratio has resampler tables the two must agree exactly.
+// Without them DelayBuffer computes the phase in float, which the
+// quantizer can turn into one step now and then; there anything beyond
+// kMaxStepsOff steps, or more than kMaxOffFraction of samples off by more
+// than rounding noise, fails the scenario.
+// A failure prints the scenario seed, which reruns it alone:
+//
+//   equivalencecheck [scenarios] [seed]
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include "referencedelay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Yonie;
+
+namespace {
+
+constexpr int kDefaultScenarios = 200;
+constexpr int kBlocksPerScenario = 60;
+constexpr int kMaxBlockSize = 3000;
+constexpr int kMaxDelayMs = 500;
+constexpr uint64_t kNoiseSeed = 0x5EED5EED5EED5EEDull;
+
+// Tolerance without resampler tables, in steps of the coarsest quantizer
+// the block's output has been through: the output quantizer at this or
+// the previous block's bit depth (filter memory), and a packed 12-bit
+// line. Cubic weights can stretch one step a little beyond 1.
+constexpr double kMaxStepsOff = 1.5;
+constexpr double kMaxOffFraction = 0.01;
+constexpr float kRoundingNoise = 1e-6f;  // far below the smallest step
+constexpr double kPackedLineStep = 1.0 / 2048.0;
+
+constexpr double kTwoPi = 6.283185307179586;
+
+const double kHostRates[] = { 22050.0, 32000.0, 44100.0, 48000.0, 88200.0,
+                              96000.0, 176400.0, 192000.0, 47999.0, 44101.0 };
+
+const int kChunkSizes[] = { DelayBuffer::REALTIME_CHUNK_SIZE, DelayBuffer::OFFLINE_CHUNK_SIZE, 1, 7, 333 };
+
+//------------------------------------------------------------------------
+enum class Signal { Tone, Noise, Silence, Impulses, Mono, Hot, DC, NumSignals };
+
+const char* signalName(Signal signal)
+{
+    switch (signal)
+    {
+        case Signal::Tone: return "tone";
+        case Signal::Noise: return "noise";
+        case Signal::Silence: return "silence";
+        case Signal::Impulses: return "impulses";
+        case Signal::Mono: return "mono";
+        case Signal::Hot: return "hot";
+        case Signal::DC: return "dc";
+        default: return "?";
+    }
+}
+
+void fillSignal(Signal signal, float* left, float* right, int count, int64_t position,
+                double sampleRate, std::mt19937_64& rng)
+{
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (int i = 0; i < count; ++i)
+    {
+        double t = (position + i) / sampleRate;
+        switch (signal)
+        {
+            case Signal::Tone:
+                left[i] = 0.5f * static_cast<float>(std::sin(kTwoPi * 440.0 * t));
+                right[i] = 0.4f * static_cast<float>(std::sin(kTwoPi * 1234.5 * t));
+                break;
+            case Signal::Noise:
+                left[i] = 0.3f * uniform(rng);
+                right[i] = 0.3f * uniform(rng);
+                break;
+            case Signal::Silence:
+                left[i] = right[i] = 0.0f;
+                break;
+            case Signal::Impulses:
+                left[i] = ((position + i) % 1021 == 0) ? 0.9f : 0.0f;
+                right[i] = ((position + i) % 777 == 0) ? -0.9f : 0.0f;
+                break;
+            case Signal::Mono:
+                left[i] = right[i] = 0.5f * static_cast<float>(std::sin(kTwoPi * 220.0 * t));
+                break;
+            case Signal::Hot:
+                left[i] = 1.8f * static_cast<float>(std::sin(kTwoPi * 3000.0 * t));
+                right[i] = 1.5f * uniform(rng);
+                break;
+            case Signal::DC:
+                left[i] = 0.25f;
+                right[i] = -0.75f;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+// True if both resamplers between these rates use coefficient tables
+bool hasTables(double hostRate, int rateIndex)
+{
+    int64_t inputStep = 0, outputStep = 0;
+    double internalRate = DelayBuffer::INTERNAL_RATES[rateIndex];
+    LinearResampler::reduceRatio(hostRate, internalRate, inputStep, outputStep);
+    bool down = outputStep <= LinearResampler::MAX_PHASE_TABLE;
+    LinearResampler::reduceRatio(internalRate, hostRate, inputStep, outputStep);
+    return down && outputStep <= LinearResampler::MAX_PHASE_TABLE;
+}
+
+//------------------------------------------------------------------------
+struct Result
+{
+    long long samples = 0;
+    long long different = 0;   // samples not bit-identical
+    long long off = 0;         // samples off by more than kRoundingNoise
+    double worstSteps = 0.0;   // largest difference in quantizer steps
+    long long worstAt = -1;
+    int worstBlock = -1;
+};
+
+//------------------------------------------------------------------------
+// One randomized scenario; false if the outputs diverge
+bool runScenario(uint64_t scenarioSeed, bool verbose)
+{
+    std::mt19937_64 rng(scenarioSeed);
+    auto pick = [&rng](int n) { return static_cast<int>(rng() % static_cast<uint64_t>(n)); };
+
+    double hostRate = kHostRates[pick(static_cast<int>(std::size(kHostRates)))];
+    int rateIndex = pick(DelayBuffer::NUM_INTERNAL_RATES);
+    bool packed = pick(2) == 0;
+    int chunkSize = kChunkSizes[pick(static_cast<int>(std::size(kChunkSizes)))];
+
+    DelayBuffer buffer;
+    buffer.setNoiseSeed(kNoiseSeed);
+    buffer.setChunkSize(chunkSize);
+    buffer.setLineFormat(packed ? DelayBuffer::LineFormat::Packed12 : DelayBuffer::LineFormat::Float32);
+    buffer.setInternalRate(rateIndex);
+    buffer.prepare(hostRate, kMaxDelayMs);
+
+    ReferenceDelay reference;
+    reference.setNoiseSeed(kNoiseSeed);
+    reference.setInternalRate(rateIndex);
+    reference.prepare(hostRate, kMaxDelayMs, packed);
+
+    std::vector<float> inL(kMaxBlockSize), inR(kMaxBlockSize);
+    std::vector<float> outL(kMaxBlockSize), outR(kMaxBlockSize);
+    std::vector<float> refL(kMaxBlockSize), refR(kMaxBlockSize);
+
+    Result result;
+    bool exact = true;  // every rate so far had tables
+    int64_t position = 0;
+    int delayMs = 1 + pick(kMaxDelayMs);
+    int bitDepth = DelayBuffer::DEFAULT_BIT_DEPTH;
+    double previousStep = 0.0;
+    Signal signal = Signal::Tone;
+
+    for (int block = 0; block < kBlocksPerScenario; ++block)
+    {
+        // Parameter and signal changes between blocks
+        if (pick(3) == 0)
+            delayMs = 1 + pick(kMaxDelayMs);
+        if (pick(4) == 0)
+        {
+            int tier = pick(3);
+            buffer.setQuality(static_cast<DelayBuffer::Quality>(tier));
+            reference.setQuality(static_cast<ReferenceDelay::Quality>(tier));
+        }
+        if (pick(4) == 0)
+        {
+            bitDepth = DelayBuffer::MIN_BIT_DEPTH
+                     + pick(DelayBuffer::MAX_BIT_DEPTH - DelayBuffer::MIN_BIT_DEPTH + 1);
+            buffer.setBitDepth(bitDepth);
+            reference.setBitDepth(bitDepth);
+        }
+        if (pick(20) == 0)
+        {
+            rateIndex = pick(DelayBuffer::NUM_INTERNAL_RATES);
+            buffer.setInternalRate(rateIndex);
+            reference.setInternalRate(rateIndex);
+        }
+        if (pick(3) == 0)
+            signal = static_cast<Signal>(pick(static_cast<int>(Signal::NumSignals)));
+
+        int numSamples = 1 + pick(kMaxBlockSize);
+        fillSignal(signal, inL.data(), inR.data(), numSamples, position, hostRate, rng);
+
+        // Mono blocks pass one buffer as both inputs, as mono hosts do
+        const float* rightIn = (signal == Signal::Mono) ? inL.data() : inR.data();
+        buffer.processStereo(inL.data(), outL.data(), rightIn, outR.data(), numSamples, delayMs);
+        reference.processStereo(inL.data(), refL.data(), rightIn, refR.data(), numSamples, delayMs);
+
+        double outputStep = std::ldexp(1.0, -bitDepth);
+        double step = std::max(outputStep, previousStep);
+        if (packed)
+            step = std::max(step, kPackedLineStep);
+        previousStep = outputStep;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float diffs[2] = { std::fabs(outL[i] - refL[i]), std::fabs(outR[i] - refR[i]) };
+            for (float diff : diffs)
+            {
+                ++result.samples;
+                if (!(diff == 0.0f))
+                    ++result.different;
+                if (!(diff <= kRoundingNoise))
+                    ++result.off;
+                double steps = std::isnan(diff) ? 1e9 : diff / step;
+                if (steps > result.worstSteps)
+                {
+                    result.worstSteps = steps;
+                    result.worstAt = position + i;
+                    result.worstBlock = block;
+                }
+            }
+        }
+        position += numSamples;
+        exact = exact && hasTables(hostRate, rateIndex);
+
+        if (verbose)
+            std::printf("  block %2d: %4d samples, %3d ms, %2d bit, %s\n",
+                        block, numSamples, delayMs, bitDepth, signalName(signal));
+    }
+
+    double offFraction = result.samples > 0 ? static_cast<double>(result.off) / result.samples : 0.0;
+    bool ok = exact ? result.different == 0
+                    : result.worstSteps <= kMaxStepsOff && offFraction <= kMaxOffFraction;
+    if (!ok || verbose)
+    {
+        std::printf("%s scenario %016llx: %.0f Hz -> %.0f Hz, %s line, chunk %d: "
+                    "%lld of %lld samples different, %lld off, worst %.3f steps at sample %lld (block %d)%s\n",
+                    ok ? "ok    " : "FAILED", static_cast<unsigned long long>(scenarioSeed),
+                    hostRate, DelayBuffer::INTERNAL_RATES[rateIndex], packed ? "packed" : "float",
+                    chunkSize, result.different, result.samples, result.off,
+                    result.worstSteps, result.worstAt, result.worstBlock, exact ? ", must be exact" : "");
+    }
+    return ok;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int numScenarios = argc > 1 ? std::atoi(argv[1]) : kDefaultScenarios;
+    uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 16) : 1;
+
+    // A single scenario with an explicit seed is a rerun: show its blocks
+    if (argc > 2 && numScenarios == 1)
+        return runScenario(seed, true) ? 0 : 1;
+
+    std::mt19937_64 seeds(seed);
+    int failures = 0;
+    for (int i = 0; i < numScenarios; ++i)
+    {
+        if (!runScenario(seeds(), false))
+            ++failures;
+    }
+
+    std::printf("%d of %d scenarios equivalent to the reference\n", numScenarios - failures, numScenarios);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// hostharness - Headless host for end-to-end runs of the built plug-in
+//
+// Loads the plug-in binary through the SDK's hosting classes, connects
+// processor and controller, and drives process() in real-time mode with
+// synthetic audio. Along the way it automates kDelayTimeParam, relays the
+// output parameters to the controller like a host does, and saves and
+// restores the state. Reports per-block timing against the real-time
+// budget, output parameter traffic, and heap allocations made inside
+// process() (counted where the plug-in shares the host's operator new,
+// i.e. not on Windows).
+//
+//   hostharness <WetDelay.vst3> [sample rate] [block size] [seconds]
+//------------------------------------------------------------------------
+
+#include "public.sdk/source/common/memorystream.h"
+#include "public.sdk/source/vst/hosting/hostclasses.h"
+#include "public.sdk/source/vst/hosting/module.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+#include "public.sdk/source/vst/hosting/plugprovider.h"
+#include "public.sdk/source/vst/hosting/processdata.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstcomponent.h"
+#include "pluginterfaces/vst/ivsteditcontroller.h"
+#include "pluginterfaces/vst/ivstprocesscontext.h"
+#include "../source/wetdelaycids.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// Allocation counter: active only around process()
+//------------------------------------------------------------------------
+static std::atomic<bool> gCountAllocations{false};
+static std::atomic<long long> gAllocations{0};
+
+void* operator new(std::size_t size)
+{
+    if (gCountAllocations.load(std::memory_order_relaxed))
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// How often the harness acts, in blocks
+constexpr int kAutomationInterval = 37;  // delay time change
+constexpr int kStateInterval = 500;      // getState/setState round trip
+
+constexpr double kTwoPi = 6.283185307179586;
+
+using Clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------
+double microsSince(Clock::time_point start)
+{
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    return elapsed.count();
+}
+
+//------------------------------------------------------------------------
+double percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0.0;
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+//------------------------------------------------------------------------
+// Bursts of a swept tone over quiet noise, so the line sees both signal
+// and near-silence
+void fillInput(float* left, float* right, int count, int64 position, double sampleRate)
+{
+    uint32 noise = static_cast<uint32>(position) * 2654435761u + 1;
+    for (int i = 0; i < count; ++i)
+    {
+        double t = (position + i) / sampleRate;
+        bool burst = std::fmod(t, 1.0) < 0.25;
+        float tone = burst ? 0.5f * static_cast<float>(std::sin(kTwoPi * (220.0 + 200.0 * t) * t)) : 0.0f;
+        noise = noise * 1664525u + 1013904223u;
+        float hiss = 0.001f * (static_cast<float>(noise >> 8) / 8388608.0f - 1.0f);
+        left[i] = tone + hiss;
+        right[i] = 0.8f * tone - hiss;
+    }
+}
+
+//------------------------------------------------------------------------
+struct Options
+{
+    std::string path;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    double seconds = 30.0;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    if (argc < 2)
+        return false;
+    options.path = argv[1];
+    if (argc > 2)
+        options.sampleRate = std::atof(argv[2]);
+    if (argc > 3)
+        options.blockSize = std::atoi(argv[3]);
+    if (argc > 4)
+        options.seconds = std::atof(argv[4]);
+    return options.sampleRate > 0.0 && options.blockSize > 0 && options.seconds > 0.0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::printf("usage: %s <plug-in bundle> [sample rate] [block size] [seconds]\n", argv[0]);
+        return 2;
+    }
+
+    //--- Load and wire up ---------------------------------------------
+    HostApplication hostApp;
+    PluginContextFactory::instance().setPluginContext(&hostApp);
+
+    std::string error;
+    auto module = VST3::Hosting::Module::create(options.path, error);
+    if (!module)
+    {
+        std::printf("FAILED: cannot load %s: %s\n", options.path.c_str(), error.c_str());
+        return 1;
+    }
+
+    IPtr<PlugProvider> provider;
+    for (const auto& classInfo : module->getFactory().classInfos())
+    {
+        if (classInfo.category() == kVstAudioEffectClass)
+        {
+            provider = owned(new PlugProvider(module->getFactory(), classInfo, true));
+            break;
+        }
+    }
+    if (!provider || !provider->initialize())
+    {
+        std::printf("FAILED: no audio effect class could be instantiated\n");
+        return 1;
+    }
+
+    IPtr<IComponent> component = owned(provider->getComponent());
+    IPtr<IEditController> controller = owned(provider->getController());
+    FUnknownPtr<IAudioProcessor> processor(component);
+    if (!component || !controller || !processor)
+    {
+        std::printf("FAILED: plug-in has no processor or controller\n");
+        return 1;
+    }
+
+    //--- Set up processing --------------------------------------------
+    ProcessSetup setup{kRealtime, kSample32, options.blockSize, options.sampleRate};
+    SpeakerArrangement stereo = SpeakerArr::kStereo;
+    if (processor->setupProcessing(setup) != kResultOk
+        || processor->setBusArrangements(&stereo, 1, &stereo, 1) != kResultOk)
+    {
+        std::printf("FAILED: stereo setup rejected\n");
+        return 1;
+    }
+    component->activateBus(kAudio, kInput, 0, true);
+    component->activateBus(kAudio, kOutput, 0, true);
+
+    HostProcessData data;
+    data.prepare(*component, options.blockSize, kSample32);
+
+    ParameterChanges inputChanges(1);
+    ParameterChanges outputChanges(kParamCount);
+    ProcessContext context{};
+    context.state = ProcessContext::kPlaying | ProcessContext::kTempoValid;
+    context.sampleRate = options.sampleRate;
+    context.tempo = 120.0;
+
+    data.numSamples = options.blockSize;
+    data.inputParameterChanges = &inputChanges;
+    data.outputParameterChanges = &outputChanges;
+    data.processContext = &context;
+
+    component->setActive(true);
+    processor->setProcessing(true);
+
+    //--- Run ----------------------------------------------------------
+    const int numBlocks = static_cast<int>(options.seconds * options.sampleRate / options.blockSize);
+    const double budgetUs = 1e6 * options.blockSize / options.sampleRate;
+
+    std::vector<double> blockUs;
+    std::vector<double> stateUs;
+    blockUs.reserve(numBlocks);
+    stateUs.reserve(numBlocks / kStateInterval + 1);
+
+    long long outputQueues = 0;
+    long long outputPoints = 0;
+    long long processAllocations = 0;
+    int delayIndex = 0;
+
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        fillInput(data.inputs[0].channelBuffers32[0], data.inputs[0].channelBuffers32[1],
+                  options.blockSize, context.projectTimeSamples, options.sampleRate);
+
+        // Automation: a delay time step in the middle of the block
+        inputChanges.clearQueue();
+        if (block % kAutomationInterval == 0)
+        {
+            delayIndex = (delayIndex + 1) % kNumDelayTimes;
+            ParamValue value = delayIndex / static_cast<double>(kNumDelayTimes - 1);
+            int32 queueIndex = 0, pointIndex = 0;
+            if (IParamValueQueue* queue = inputChanges.addParameterData(kDelayTimeParam, queueIndex))
+                queue->addPoint(options.blockSize / 2, value, pointIndex);
+            controller->setParamNormalized(kDelayTimeParam, value);
+        }
+        outputChanges.clearQueue();
+
+        gAllocations.store(0, std::memory_order_relaxed);
+        gCountAllocations.store(true, std::memory_order_relaxed);
+        auto start = Clock::now();
+        processor->process(data);
+        blockUs.push_back(microsSince(start));
+        gCountAllocations.store(false, std::memory_order_relaxed);
+        processAllocations += gAllocations.load(std::memory_order_relaxed);
+
+        // Relay output parameters (meters) to the controller, as hosts do
+        int32 numQueues = outputChanges.getParameterCount();
+        outputQueues += numQueues;
+        for (int32 q = 0; q < numQueues; ++q)
+        {
+            IParamValueQueue* queue = outputChanges.getParameterData(q);
+            int32 numPoints = queue->getPointCount();
+            outputPoints += numPoints;
+            int32 offset = 0;
+            ParamValue value = 0.0;
+            if (numPoints > 0 && queue->getPoint(numPoints - 1, offset, value) == kResultOk)
+                controller->setParamNormalized(queue->getParameterId(), value);
+        }
+
+        // Session save and reload while running
+        if (block % kStateInterval == kStateInterval - 1)
+        {
+            auto stateStart = Clock::now();
+            IPtr<MemoryStream> stream = owned(new MemoryStream());
+            component->getState(stream);
+            stream->seek(0, IBStream::kIBSeekSet, nullptr);
+            component->setState(stream);
+            stream->seek(0, IBStream::kIBSeekSet, nullptr);
+            controller->setComponentState(stream);
+            stateUs.push_back(microsSince(stateStart));
+        }
+
+        context.projectTimeSamples += options.blockSize;
+        context.continousTimeSamples += options.blockSize;
+    }
+
+    processor->setProcessing(false);
+    component->setActive(false);
+    data.unprepare();
+
+    //--- Report -------------------------------------------------------
+    double total = 0.0, worst = 0.0;
+    int overBudget = 0;
+    for (double us : blockUs)
+    {
+        total += us;
+        worst = std::max(worst, us);
+        if (us > budgetUs)
+            ++overBudget;
+    }
+    double mean = blockUs.empty() ? 0.0 : total / blockUs.size();
+    double audioSeconds = static_cast<double>(numBlocks) * options.blockSize / options.sampleRate;
+
+    std::printf("%s, %.0f Hz, %d-sample blocks, %.1f s of audio\n",
+                options.path.c_str(), options.sampleRate, options.blockSize, audioSeconds);
+    std::printf("\nprocess() per block (budget %.1f us)\n", budgetUs);
+    std::printf("  mean %9.2f us  (%.2f%% of budget, %.2f ns/frame)\n",
+                mean, 100.0 * mean / budgetUs, 1000.0 * mean / options.blockSize);
+    std::printf("  p50  %9.2f us\n", percentile(blockUs, 0.5));
+    std::printf("  p99  %9.2f us\n", percentile(blockUs, 0.99));
+    std::printf("  max  %9.2f us  (%d blocks over budget)\n", worst, overBudget);
+    std::printf("\nOutput parameters: %lld queues, %lld points (%.1f points/s)\n",
+                outputQueues, outputPoints, audioSeconds > 0.0 ? outputPoints / audioSeconds : 0.0);
+    if (!stateUs.empty())
+        std::printf("State round trip: %zu times, p50 %.1f us, max %.1f us\n", stateUs.size(),
+                    percentile(stateUs, 0.5), *std::max_element(stateUs.begin(), stateUs.end()));
+#if defined(_WIN32)
+    std::printf("Allocations in process(): not counted on Windows\n");
+#else
+    std::printf("Allocations in process(): %lld\n", processAllocations);
+#endif
+
+    return processAllocations == 0 ? 0 : 1;
+}
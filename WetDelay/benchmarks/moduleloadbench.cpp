@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// moduleloadbench - What a host pays to scan the built plug-in
+//
+// Loads the plug-in binary the way a scanner does and times each step:
+// loading the library (static initializers), the module entry, getting the
+// factory and enumerating its classes, and creating and initializing the
+// processor and controller. No editor is opened, so none of this should
+// touch the GUI.
+//
+//   moduleloadbench <path to WetDelay.so / WetDelay.vst3 binary>
+//------------------------------------------------------------------------
+
+#include "pluginterfaces/base/ipluginbase.h"
+#include "pluginterfaces/vst/ivstcomponent.h"
+#include "pluginterfaces/vst/ivsteditcontroller.h"
+#include <chrono>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+using namespace Steinberg;
+
+namespace {
+
+constexpr int kInstanceRepeats = 100;
+
+using Clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------
+double millisSince(Clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    return elapsed.count();
+}
+
+//------------------------------------------------------------------------
+// Platform module entry points, as the VST3 module spec names them
+#if defined(_WIN32)
+using ModuleHandle = HMODULE;
+using EntryProc = bool (PLUGIN_API*)();
+const char* kEntryName = "InitDll";
+const char* kExitName = "ExitDll";
+
+ModuleHandle loadModule(const char* path) { return LoadLibraryA(path); }
+void* findSymbol(ModuleHandle module, const char* name) { return reinterpret_cast<void*>(GetProcAddress(module, name)); }
+void unloadModule(ModuleHandle module) { FreeLibrary(module); }
+bool callEntry(void* entry) { return reinterpret_cast<EntryProc>(entry)(); }
+bool callExit(void* exitProc) { return reinterpret_cast<EntryProc>(exitProc)(); }
+#else
+using ModuleHandle = void*;
+using EntryProc = bool (PLUGIN_API*)(void*);
+using ExitProc = bool (PLUGIN_API*)();
+const char* kEntryName = "ModuleEntry";
+const char* kExitName = "ModuleExit";
+
+ModuleHandle loadModule(const char* path) { return dlopen(path, RTLD_LAZY | RTLD_LOCAL); }
+void* findSymbol(ModuleHandle module, const char* name) { return dlsym(module, name); }
+void unloadModule(ModuleHandle module) { dlclose(module); }
+bool callEntry(void* entry) { return reinterpret_cast<EntryProc>(entry)(nullptr); }
+bool callExit(void* exitProc) { return reinterpret_cast<ExitProc>(exitProc)(); }
+#endif
+
+//------------------------------------------------------------------------
+// Create, initialize and terminate one instance of the class
+bool createAndInitialize(IPluginFactory* factory, const PClassInfo& info)
+{
+    FUnknown* object = nullptr;
+    if (factory->createInstance(info.cid, FUnknown::iid, reinterpret_cast<void**>(&object)) != kResultOk || !object)
+        return false;
+
+    IPluginBase* base = nullptr;
+    bool ok = object->queryInterface(IPluginBase::iid, reinterpret_cast<void**>(&base)) == kResultOk && base;
+    if (ok)
+    {
+        ok = base->initialize(nullptr) == kResultOk;
+        base->terminate();
+        base->release();
+    }
+    object->release();
+    return ok;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("usage: %s <plug-in binary>\n", argv[0]);
+        return 2;
+    }
+
+    auto start = Clock::now();
+    ModuleHandle module = loadModule(argv[1]);
+    double loadMs = millisSince(start);
+    if (!module)
+    {
+        std::printf("FAILED: cannot load %s\n", argv[1]);
+        return 1;
+    }
+
+    void* entry = findSymbol(module, kEntryName);
+    void* exitProc = findSymbol(module, kExitName);
+    auto getFactory = reinterpret_cast<GetFactoryProc>(findSymbol(module, "GetPluginFactory"));
+    if (!entry || !getFactory)
+    {
+        std::printf("FAILED: missing module entry points\n");
+        return 1;
+    }
+
+    start = Clock::now();
+    if (!callEntry(entry))
+    {
+        std::printf("FAILED: %s returned false\n", kEntryName);
+        return 1;
+    }
+    double entryMs = millisSince(start);
+
+    // Factory and class enumeration: all a metadata-only scan needs
+    start = Clock::now();
+    IPluginFactory* factory = getFactory();
+    int32 numClasses = factory ? factory->countClasses() : 0;
+    PClassInfo infos[8];
+    for (int32 i = 0; i < numClasses && i < 8; ++i)
+        factory->getClassInfo(i, &infos[i]);
+    double factoryMs = millisSince(start);
+    if (!factory)
+    {
+        std::printf("FAILED: no plug-in factory\n");
+        return 1;
+    }
+
+    std::printf("Module load of %s\n", argv[1]);
+    std::printf("%-28s %10.3f ms\n", "load library", loadMs);
+    std::printf("%-28s %10.3f ms\n", kEntryName, entryMs);
+    std::printf("%-28s %10.3f ms  (%d classes)\n", "factory + class info", factoryMs, numClasses);
+
+    // Instantiation, as hosts do when they scan parameters
+    bool allOk = true;
+    for (int32 i = 0; i < numClasses && i < 8; ++i)
+    {
+        bool ok = true;
+        start = Clock::now();
+        for (int r = 0; r < kInstanceRepeats; ++r)
+            ok = createAndInitialize(factory, infos[i]) && ok;
+        double instanceMs = millisSince(start) / kInstanceRepeats;
+        allOk = allOk && ok;
+
+        std::printf("%-28.28s %10.3f ms  per instance%s\n", infos[i].name, instanceMs, ok ? "" : "  FAILED");
+    }
+
+    factory->release();
+    if (exitProc)
+        callExit(exitProc);
+    unloadModule(module);
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,414 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// qualitybench - Audio quality of the delay chain against its cost
+//
+// For every host rate and engine setting (internal rate, tier, line
+// format; 12-bit output) renders test signals through
+// DelayBuffer::processStereo and measures on the delayed output:
+// - noise floor: RMS of the output for silent input, dBFS
+// - response: gain at 80 Hz, 1 kHz and 9 kHz, the corners of the
+//   character (80 Hz high-pass, 9 kHz low-pass at 24 kHz)
+// - THD: harmonics 2-9 of a -6 dBFS 1 kHz tone, up to 0.45 x the
+//   internal rate, relative to the fundamental
+// - aliasing: a tone at 0.75 x the internal rate folds to 0.25 x; level
+//   of the fold relative to the input tone
+// - imaging: a tone at 0.25 x the internal rate mirrors to 0.75 x on the
+//   way back up; level of the image relative to the input tone
+// next to the processing cost in ns per host sample. Levels are read with
+// a Hann-windowed single-bin DFT. All renders use a fixed noise seed, so
+// everything but the timing is deterministic.
+//
+//   qualitybench [--csv <results.csv>] [--baseline <baseline.csv>]
+//
+// --csv writes the table for plotting (cost on one axis, any quality
+// column on the other). --baseline compares against a saved run and
+// fails if the response moved or noise, THD, aliasing or imaging got
+// worse; qualitybaseline.csv next to this file is the shipped character.
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Yonie;
+
+namespace {
+
+const double kHostRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+const char* const kTierNames[] = { "eco", "standard", "high" };
+const char* const kLineNames[] = { "float", "packed" };
+
+constexpr int kMaxDelayMs = 100;
+constexpr int kDelayMs = 20;
+constexpr int kBlockSize = 512;
+constexpr double kSettleSeconds = 0.1;    // after the delay, before analysis
+constexpr double kAnalysisSeconds = 0.25;
+constexpr double kTimingSeconds = 2.0;
+constexpr uint64_t kNoiseSeed = 0x5EED5EED5EED5EEDull;
+
+constexpr double kTwoPi = 6.283185307179586;
+constexpr double kToneLevel = 0.5;        // -6 dBFS
+constexpr double kThdFundamental = 1000.0;
+constexpr double kResponseFreqs[] = { 80.0, 1000.0, 9000.0 };
+constexpr double kBandEdge = 0.45;        // usable fraction of a sample rate
+
+// Baseline tolerances: response either way, the rest only when worse
+constexpr double kResponseToleranceDb = 0.25;
+constexpr double kNoiseToleranceDb = 1.0;
+constexpr double kThdToleranceDb = 2.0;
+constexpr double kSpuriousToleranceDb = 3.0;
+
+using Clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------
+struct Setting
+{
+    double hostRate;
+    int rateIndex;
+    int tier;
+    int line;
+
+    std::string key() const
+    {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%.0f,%.0f,%s,%s", hostRate,
+                      DelayBuffer::INTERNAL_RATES[rateIndex], kTierNames[tier], kLineNames[line]);
+        return text;
+    }
+};
+
+// Quality columns; NAN where the measurement does not fit the rates
+enum Column { kNoise, kGain80, kGain1k, kGain9k, kThd, kAlias, kImage, kNumColumns };
+const char* const kColumnNames[kNumColumns] = { "noise_dbfs", "gain_80_db", "gain_1k_db", "gain_9k_db",
+                                                "thd_db", "alias_db", "image_db" };
+
+struct Measurement
+{
+    double nsPerSample = 0.0;
+    double values[kNumColumns];
+};
+
+//------------------------------------------------------------------------
+double toDb(double ratio)
+{
+    return ratio > 0.0 ? 20.0 * std::log10(ratio) : -999.0;
+}
+
+//------------------------------------------------------------------------
+// Amplitude of the component at 'freq', Hann window, any frequency
+double amplitudeAt(const std::vector<float>& signal, double freq, double sampleRate)
+{
+    size_t n = signal.size();
+    double re = 0.0, im = 0.0, windowSum = 0.0;
+    double step = kTwoPi * freq / sampleRate;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double w = 0.5 - 0.5 * std::cos(kTwoPi * i / n);
+        re += w * signal[i] * std::cos(step * i);
+        im -= w * signal[i] * std::sin(step * i);
+        windowSum += w;
+    }
+    return 2.0 * std::sqrt(re * re + im * im) / windowSum;
+}
+
+//------------------------------------------------------------------------
+class Renderer
+{
+public:
+    explicit Renderer(const Setting& setting)
+    : setting(setting)
+    {
+        buffer.setNoiseSeed(kNoiseSeed);
+        buffer.setLineFormat(setting.line ? DelayBuffer::LineFormat::Packed12
+                                          : DelayBuffer::LineFormat::Float32);
+        buffer.setInternalRate(setting.rateIndex);
+        buffer.setQuality(static_cast<DelayBuffer::Quality>(setting.tier));
+        buffer.prepare(setting.hostRate, kMaxDelayMs);
+    }
+
+    double internalRate() const { return buffer.getInternalRate(); }
+
+    // Left output for a tone (0 Hz: silence) on both inputs, once the
+    // delay has passed and the filters settled
+    std::vector<float> renderTone(double freq, double level)
+    {
+        buffer.reset();
+        double rate = setting.hostRate;
+        int skip = static_cast<int>((kDelayMs / 1000.0 + kSettleSeconds) * rate);
+        int total = skip + static_cast<int>(kAnalysisSeconds * rate);
+
+        std::vector<float> input(total), outL(total), outR(total);
+        for (int i = 0; i < total; ++i)
+            input[i] = static_cast<float>(level * std::sin(kTwoPi * freq * i / rate));
+        for (int pos = 0; pos < total; pos += kBlockSize)
+        {
+            int count = std::min(kBlockSize, total - pos);
+            buffer.processStereo(input.data() + pos, outL.data() + pos,
+                                 input.data() + pos, outR.data() + pos, count, kDelayMs);
+        }
+        return std::vector<float>(outL.begin() + skip, outL.end());
+    }
+
+    // Stereo program material in host-sized blocks
+    double nanosPerSample()
+    {
+        int total = static_cast<int>(kTimingSeconds * setting.hostRate);
+        std::vector<float> inL(total), inR(total), outL(total), outR(total);
+        NoiseGenerator noise;
+        for (int i = 0; i < total; ++i)
+        {
+            inL[i] = 0.3f * static_cast<float>(std::sin(kTwoPi * 440.0 * i / setting.hostRate)) + 0.05f * noise.next();
+            inR[i] = 0.05f * noise.next();
+        }
+
+        double best = 1e30;
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            auto start = Clock::now();
+            for (int pos = 0; pos < total; pos += kBlockSize)
+            {
+                int count = std::min(kBlockSize, total - pos);
+                buffer.processStereo(inL.data() + pos, outL.data() + pos,
+                                     inR.data() + pos, outR.data() + pos, count, kDelayMs);
+            }
+            std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+            best = std::min(best, elapsed.count() / total);
+        }
+        return best;
+    }
+
+private:
+    Setting setting;
+    DelayBuffer buffer;
+};
+
+//------------------------------------------------------------------------
+Measurement measure(const Setting& setting)
+{
+    Renderer renderer(setting);
+    double hostRate = setting.hostRate;
+    double internalRate = renderer.internalRate();
+    double band = kBandEdge * std::min(hostRate, internalRate);
+
+    Measurement m;
+    std::fill(std::begin(m.values), std::end(m.values), NAN);
+
+    // Noise floor
+    std::vector<float> silence = renderer.renderTone(0.0, 0.0);
+    double sumSquares = 0.0;
+    for (float x : silence)
+        sumSquares += static_cast<double>(x) * x;
+    m.values[kNoise] = toDb(std::sqrt(sumSquares / silence.size()));
+
+    // Response at the character corners
+    for (int i = 0; i < 3; ++i)
+    {
+        double freq = kResponseFreqs[i];
+        if (freq < band)
+            m.values[kGain80 + i] = toDb(amplitudeAt(renderer.renderTone(freq, kToneLevel), freq, hostRate) / kToneLevel);
+    }
+
+    // Harmonic distortion
+    std::vector<float> tone = renderer.renderTone(kThdFundamental, kToneLevel);
+    double fundamental = amplitudeAt(tone, kThdFundamental, hostRate);
+    double harmonics = 0.0;
+    for (int h = 2; h <= 9 && h * kThdFundamental < band; ++h)
+    {
+        double a = amplitudeAt(tone, h * kThdFundamental, hostRate);
+        harmonics += a * a;
+    }
+    m.values[kThd] = toDb(std::sqrt(harmonics) / fundamental);
+
+    // Fold-down of a tone above the internal Nyquist
+    double aliasTone = 0.75 * internalRate;
+    if (aliasTone < kBandEdge * hostRate)
+    {
+        double fold = internalRate - aliasTone;
+        m.values[kAlias] = toDb(amplitudeAt(renderer.renderTone(aliasTone, kToneLevel), fold, hostRate) / kToneLevel);
+    }
+
+    // Image of an in-band tone above the internal Nyquist
+    double imageTone = 0.25 * internalRate;
+    double image = internalRate - imageTone;
+    if (image < kBandEdge * hostRate)
+        m.values[kImage] = toDb(amplitudeAt(renderer.renderTone(imageTone, kToneLevel), image, hostRate) / kToneLevel);
+
+    m.nsPerSample = renderer.nanosPerSample();
+    return m;
+}
+
+//------------------------------------------------------------------------
+// Baseline file: the CSV this tool writes, keyed by setting
+using Baseline = std::map<std::string, Measurement>;
+
+bool loadBaseline(const char* path, Baseline& baseline)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    std::getline(file, line);  // header
+    while (std::getline(file, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ','))
+            fields.push_back(field);
+        if (!line.empty() && line.back() == ',')
+            fields.push_back("");  // getline drops a trailing empty field
+        if (fields.size() != 5 + kNumColumns)
+            continue;
+
+        Measurement m;
+        m.nsPerSample = std::atof(fields[4].c_str());
+        for (int c = 0; c < kNumColumns; ++c)
+            m.values[c] = fields[5 + c].empty() ? NAN : std::atof(fields[5 + c].c_str());
+        baseline[fields[0] + "," + fields[1] + "," + fields[2] + "," + fields[3]] = m;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+// Regressions of 'now' against 'then', printed; returns their number
+int compareWithBaseline(const std::string& key, const Measurement& now, const Measurement& then)
+{
+    int regressions = 0;
+    for (int c = 0; c < kNumColumns; ++c)
+    {
+        double a = now.values[c];
+        double b = then.values[c];
+        if (std::isnan(a) && std::isnan(b))
+            continue;
+
+        bool regressed;
+        if (std::isnan(a) || std::isnan(b))
+            regressed = true;
+        else if (c >= kGain80 && c <= kGain9k)
+            regressed = std::fabs(a - b) > kResponseToleranceDb;
+        else if (c == kNoise)
+            regressed = a > b + kNoiseToleranceDb;
+        else if (c == kThd)
+            regressed = a > b + kThdToleranceDb;
+        else
+            regressed = a > b + kSpuriousToleranceDb;
+
+        if (regressed)
+        {
+            std::printf("REGRESSION %s: %s %.2f, baseline %.2f\n", key.c_str(), kColumnNames[c], a, b);
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+//------------------------------------------------------------------------
+void printValue(double value)
+{
+    if (std::isnan(value))
+        std::printf(" %8s", "-");
+    else
+        std::printf(" %8.2f", value);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    const char* csvPath = nullptr;
+    const char* baselinePath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--csv") == 0)
+            csvPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--baseline") == 0)
+            baselinePath = argv[i + 1];
+    }
+
+    Baseline baseline;
+    if (baselinePath && !loadBaseline(baselinePath, baseline))
+    {
+        std::printf("FAILED: cannot read baseline %s\n", baselinePath);
+        return 2;
+    }
+
+    FILE* csv = csvPath ? std::fopen(csvPath, "w") : nullptr;
+    if (csv)
+    {
+        std::fprintf(csv, "host_hz,internal_hz,tier,line,ns_per_sample");
+        for (const char* name : kColumnNames)
+            std::fprintf(csv, ",%s", name);
+        std::fprintf(csv, "\n");
+    }
+
+    std::printf("DelayBuffer quality vs. cost, %d-bit output, %d-sample blocks (levels in dB)\n",
+                DelayBuffer::DEFAULT_BIT_DEPTH, kBlockSize);
+    std::printf("%7s %6s %-8s %-6s %8s %8s %8s %8s %8s %8s %8s %8s\n", "host", "int", "tier", "line",
+                "ns/smp", "noise", "80 Hz", "1 kHz", "9 kHz", "THD", "alias", "image");
+
+    int regressions = 0;
+    int compared = 0;
+    for (double hostRate : kHostRates)
+    {
+        for (int rateIndex = 0; rateIndex < DelayBuffer::NUM_INTERNAL_RATES; ++rateIndex)
+        {
+            for (int tier = 0; tier < 3; ++tier)
+            {
+                for (int line = 0; line < 2; ++line)
+                {
+                    Setting setting{hostRate, rateIndex, tier, line};
+                    Measurement m = measure(setting);
+
+                    std::printf("%7.0f %6.0f %-8s %-6s %8.2f", hostRate, DelayBuffer::INTERNAL_RATES[rateIndex],
+                                kTierNames[tier], kLineNames[line], m.nsPerSample);
+                    for (double value : m.values)
+                        printValue(value);
+                    std::printf("\n");
+
+                    if (csv)
+                    {
+                        std::fprintf(csv, "%s,%.3f", setting.key().c_str(), m.nsPerSample);
+                        for (double value : m.values)
+                        {
+                            if (std::isnan(value))
+                                std::fprintf(csv, ",");
+                            else
+                                std::fprintf(csv, ",%.3f", value);
+                        }
+                        std::fprintf(csv, "\n");
+                    }
+
+                    auto found = baseline.find(setting.key());
+                    if (found != baseline.end())
+                    {
+                        regressions += compareWithBaseline(setting.key(), m, found->second);
+                        ++compared;
+                    }
+                }
+            }
+        }
+    }
+
+    if (csv)
+        std::fclose(csv);
+
+    if (baselinePath)
+    {
+        std::printf("\n%d settings compared with %s, %d regressions\n", compared, baselinePath, regressions);
+        if (regressions > 0 || compared == 0)
+            return 1;
+    }
+    return 0;
+}
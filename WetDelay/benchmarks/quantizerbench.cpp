@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// quantizerbench - Integer-domain quantizer vs. the std::floor reference
+//
+// Times the scalar quantizeToLevels() and the block quantizeBlockToLevels()
+// the engine runs against the floating-point rounding they replaced, at
+// every supported bit depth, and checks all three agree bit for bit. Then
+// times a full DelayBuffer render per bit depth.
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Yonie;
+
+namespace {
+
+constexpr int kSamples = 1 << 20;
+constexpr int kRepeats = 50;
+constexpr double kSampleRate = 48000.0;
+constexpr int kBlockSize = 512;
+
+using Clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------
+// The quantizer as it was before the integer path, noise floor included
+void quantizeFloor(const float* in, const float* noiseFloor, float* out, int count, float levels)
+{
+    for (int i = 0; i < count; ++i)
+        out[i] = std::floor(in[i] * levels + 0.5f) / levels + noiseFloor[i];
+}
+
+//------------------------------------------------------------------------
+void quantizeScalar(const float* in, const float* noiseFloor, float* out, int count,
+                    float levels, float invLevels)
+{
+    for (int i = 0; i < count; ++i)
+        out[i] = quantizeToLevels(in[i], levels, invLevels) + noiseFloor[i];
+}
+
+//------------------------------------------------------------------------
+void quantizeBlock(const float* in, const float* noiseFloor, float* out, int count,
+                   float levels, float invLevels)
+{
+    std::memcpy(out, in, count * sizeof(float));
+    quantizeBlockToLevels(out, noiseFloor, count, levels, invLevels);
+}
+
+//------------------------------------------------------------------------
+template <typename Fn>
+double nanosPerSample(Fn&& fn, int samplesPerCall)
+{
+    fn();  // warm up
+    auto start = Clock::now();
+    for (int r = 0; r < kRepeats; ++r)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / (static_cast<double>(samplesPerCall) * kRepeats);
+}
+
+//------------------------------------------------------------------------
+// Signal with dither-sized noise on top, spanning slightly past full
+// scale, and a -80 dBFS noise floor
+void fillInput(std::vector<float>& signal, std::vector<float>& noiseFloor)
+{
+    NoiseGenerator noise;
+    for (size_t i = 0; i < signal.size(); ++i)
+    {
+        signal[i] = 1.05f * std::sin(static_cast<float>(i) * 0.001f) + 0.001f * noise.next();
+        noiseFloor[i] = 0.0001f * noise.next();
+    }
+}
+
+//------------------------------------------------------------------------
+bool sameBits(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main()
+{
+    std::vector<float> input(kSamples);
+    std::vector<float> noiseFloor(kSamples);
+    std::vector<float> floorOut(kSamples);
+    std::vector<float> scalarOut(kSamples);
+    std::vector<float> blockOut(kSamples);
+    fillInput(input, noiseFloor);
+
+    bool allMatch = true;
+
+    std::printf("Quantizer + noise floor, %d samples x %d (ns per sample)\n", kSamples, kRepeats);
+    std::printf("%5s  %8s  %8s  %8s  %7s  %s\n", "bits", "floor", "scalar", "block", "speedup", "match");
+    for (int bits = DelayBuffer::MIN_BIT_DEPTH; bits <= DelayBuffer::MAX_BIT_DEPTH; ++bits)
+    {
+        float levels = static_cast<float>(1 << bits);
+        float invLevels = 1.0f / levels;
+
+        double floorNs = nanosPerSample([&] {
+            quantizeFloor(input.data(), noiseFloor.data(), floorOut.data(), kSamples, levels);
+        }, kSamples);
+        double scalarNs = nanosPerSample([&] {
+            quantizeScalar(input.data(), noiseFloor.data(), scalarOut.data(), kSamples, levels, invLevels);
+        }, kSamples);
+        double blockNs = nanosPerSample([&] {
+            quantizeBlock(input.data(), noiseFloor.data(), blockOut.data(), kSamples, levels, invLevels);
+        }, kSamples);
+
+        bool match = sameBits(floorOut, scalarOut) && sameBits(floorOut, blockOut);
+        allMatch = allMatch && match;
+
+        std::printf("%5d  %8.3f  %8.3f  %8.3f  %6.2fx  %s\n",
+                    bits, floorNs, scalarNs, blockNs, floorNs / blockNs, match ? "yes" : "NO");
+    }
+
+    // Whole engine at Standard quality: the quantizer is one stage of many
+    std::printf("\nDelayBuffer::processStereo, %.0f Hz, %d-sample blocks\n", kSampleRate, kBlockSize);
+    std::printf("%5s  %12s\n", "bits", "ns/frame");
+    std::vector<float> outL(kSamples);
+    std::vector<float> outR(kSamples);
+    for (int bits = DelayBuffer::MIN_BIT_DEPTH; bits <= DelayBuffer::MAX_BIT_DEPTH; bits += 4)
+    {
+        DelayBuffer buffer;
+        buffer.setBitDepth(bits);
+        buffer.prepare(kSampleRate, 1000);
+
+        double ns = nanosPerSample([&] {
+            for (int pos = 0; pos + kBlockSize <= kSamples; pos += kBlockSize)
+                buffer.processStereo(input.data() + pos, outL.data() + pos,
+                                     input.data() + pos, outR.data() + pos,
+                                     kBlockSize, 250);
+        }, kSamples);
+
+        std::printf("%5d  %12.3f\n", bits, ns);
+    }
+
+    if (!allMatch)
+    {
+        std::printf("\nFAILED: integer quantizer differs from the floor reference\n");
+        return 1;
+    }
+    return 0;
+}
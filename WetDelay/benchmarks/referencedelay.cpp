@@ -0,0 +1,292 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "referencedelay.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Yonie {
+
+namespace {
+
+const double kInternalRates[] = { 16000.0, 24000.0, 32000.0, 48000.0 };
+constexpr int kRingPage = 4096;
+constexpr float kCrosstalk = 0.01f;
+constexpr float kNoiseFloor = 0.0001f;
+constexpr int kNoiseDraws = 6;
+
+double onePoleCoefficient(double sampleRate, double cutoffHz)
+{
+    return std::exp(-2.0 * 3.14159265358979323846 * cutoffHz / sampleRate);
+}
+
+void setRatio(double inputRate, double outputRate, int64_t& inputStep, int64_t& outputStep)
+{
+    int64_t in = std::max<int64_t>(1, std::llround(inputRate));
+    int64_t out = std::max<int64_t>(1, std::llround(outputRate));
+    int64_t divisor = std::gcd(in, out);
+    inputStep = in / divisor;
+    outputStep = out / divisor;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+// Filters: y = (1-a) x + a y'  /  y = a (y' + x - x')
+//------------------------------------------------------------------------
+float ReferenceDelay::OnePole::process(float input)
+{
+    float a = static_cast<float>(coefficient);
+    float y = highPass ? a * (static_cast<float>(z1) + input - static_cast<float>(x1))
+                       : (1.0f - a) * input + a * static_cast<float>(z1);
+    z1 = y;
+    x1 = input;
+    return y;
+}
+
+float ReferenceDelay::OnePole::processPrecise(float input)
+{
+    double y = highPass ? coefficient * (z1 + input - x1)
+                        : (1.0 - coefficient) * input + coefficient * z1;
+    z1 = y;
+    x1 = input;
+    return static_cast<float>(y);
+}
+
+//------------------------------------------------------------------------
+// Resampler: interpolates between 'last' and 'next' at p / outputStep
+//------------------------------------------------------------------------
+float ReferenceDelay::Resampler::interpolate(int64_t p, float next, bool cubic) const
+{
+    double t = static_cast<double>(p) / static_cast<double>(outputStep);
+    if (cubic)
+    {
+        // 4-point Lagrange over prev2, prev1, last, next at -2, -1, 0, 1
+        float w0 = static_cast<float>(-(t + 1.0) * t * (t - 1.0) / 6.0);
+        float w1 = static_cast<float>((t + 2.0) * t * (t - 1.0) / 2.0);
+        float w2 = static_cast<float>(-(t + 2.0) * (t + 1.0) * (t - 1.0) / 2.0);
+        float w3 = static_cast<float>((t + 2.0) * (t + 1.0) * t / 6.0);
+        return w0 * prev2 + w1 * prev1 + w2 * last + w3 * next;
+    }
+    return last + static_cast<float>(t) * (next - last);
+}
+
+void ReferenceDelay::Resampler::push(float sample)
+{
+    prev2 = prev1;
+    prev1 = last;
+    last = sample;
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::setBitDepth(int bits)
+{
+    bitDepth = std::max(8, std::min(bits, 16));
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::setInternalRate(int newIndex)
+{
+    newIndex = std::max(0, std::min(newIndex, 3));
+    if (newIndex == rateIndex)
+        return;
+    rateIndex = newIndex;
+    if (!prepared)
+        return;
+
+    configure();
+    clearState();
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::prepare(double sampleRate, int newMaxDelayMs, bool packedLine)
+{
+    hostRate = sampleRate;
+    maxDelayMs = newMaxDelayMs;
+    packed = packedLine;
+    prepared = true;
+    configure();
+    clearState();
+    noiseCounter = 0;
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::configure()
+{
+    internalRate = kInternalRates[rateIndex];
+    maxSamples = static_cast<int>(maxDelayMs * internalRate / 1000.0);
+
+    // Band limits are defined at 24 kHz and follow the internal rate
+    double scale = internalRate / 24000.0;
+    for (Channel& ch : channels)
+    {
+        ch.antiAlias.coefficient = onePoleCoefficient(hostRate, 10000.0 * scale);
+        ch.reconstruct.coefficient = onePoleCoefficient(hostRate, 10000.0 * scale);
+        ch.highPass.coefficient = onePoleCoefficient(internalRate, 80.0);
+        ch.highPass.highPass = true;
+        ch.lowPass.coefficient = onePoleCoefficient(internalRate, 9000.0 * std::min(1.0, scale));
+        setRatio(hostRate, internalRate, ch.down.inputStep, ch.down.outputStep);
+        setRatio(internalRate, hostRate, ch.up.inputStep, ch.up.outputStep);
+    }
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::clearState()
+{
+    for (Channel& ch : channels)
+    {
+        ch.antiAlias.z1 = ch.antiAlias.x1 = 0.0;
+        ch.reconstruct.z1 = ch.reconstruct.x1 = 0.0;
+        ch.highPass.z1 = ch.highPass.x1 = 0.0;
+        ch.lowPass.z1 = ch.lowPass.x1 = 0.0;
+        ch.down.phase = ch.up.phase = 0;
+        ch.down.last = ch.down.prev1 = ch.down.prev2 = 0.0f;
+        ch.up.last = ch.up.prev1 = ch.up.prev2 = 0.0f;
+        ch.pending.clear();
+    }
+
+    // Everything in the line so far is gone
+    forgottenBefore = written;
+    capacity = std::min(kRingPage, maxSamples);
+}
+
+//------------------------------------------------------------------------
+float ReferenceDelay::nextNoise()
+{
+    uint64_t z = noiseKey + (++noiseCounter) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return static_cast<float>(z >> 40) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::processStereo(const float* leftIn, float* leftOut,
+                                   const float* rightIn, float* rightOut,
+                                   int numSamples, int delayMs)
+{
+    if (!prepared)
+        return;
+
+    int delaySamples = static_cast<int>(delayMs * internalRate / 1000.0);
+    delaySamples = std::max(1, std::min(delaySamples, maxSamples - 1));
+
+    // A longer delay grows the ring; it keeps only what it held before
+    if (delaySamples >= capacity)
+    {
+        forgottenBefore = std::max(forgottenBefore, written - capacity);
+        int pages = (delaySamples + 1 + kRingPage - 1) / kRingPage;
+        capacity = std::min(pages * kRingPage, maxSamples);
+    }
+
+    const float* inputs[2] = { leftIn, rightIn };
+    float* outputs[2] = { leftOut, rightOut };
+    bool cubic = (quality == Quality::High);
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        // Anti-alias at the host rate and downsample; both channels share
+        // the phase, so they produce the same number of frames
+        std::vector<float> frames[2];
+        for (int c = 0; c < 2; ++c)
+        {
+            Channel& ch = channels[c];
+            float x = ch.antiAlias.process(inputs[c][n]);
+            while (ch.down.phase < ch.down.outputStep)
+            {
+                frames[c].push_back(ch.down.interpolate(ch.down.phase, x, cubic));
+                ch.down.phase += ch.down.inputStep;
+            }
+            ch.down.phase -= ch.down.outputStep;
+            ch.down.push(x);
+        }
+
+        for (size_t k = 0; k < frames[0].size(); ++k)
+            processInternalFrame(frames[0][k], frames[1][k], delaySamples);
+
+        // Upsample with whatever the chain has produced so far
+        for (int c = 0; c < 2; ++c)
+        {
+            Channel& ch = channels[c];
+            float next = ch.pending.empty() ? ch.up.last : ch.pending.front();
+            float y = ch.up.interpolate(std::min(ch.up.phase, ch.up.outputStep - 1), next, cubic);
+            outputs[c][n] = ch.reconstruct.process(y);
+
+            ch.up.phase += ch.up.inputStep;
+            while (ch.up.phase >= ch.up.outputStep && !ch.pending.empty())
+            {
+                ch.up.push(ch.pending.front());
+                ch.pending.pop_front();
+                ch.up.phase -= ch.up.outputStep;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+void ReferenceDelay::processInternalFrame(float inL, float inR, int delaySamples)
+{
+    float in[2] = { inL, inR };
+    float delayed[2];
+    for (int c = 0; c < 2; ++c)
+    {
+        // The 12-bit line stores round-to-nearest steps of 1/2048
+        if (packed)
+        {
+            float steps = std::min(std::max(in[c] * 2048.0f, -2048.0f), 2047.0f);
+            in[c] = static_cast<float>(static_cast<int16_t>(std::nearbyint(steps))) * (1.0f / 2048.0f);
+        }
+
+        int64_t source = written - delaySamples;
+        std::vector<float>& history = channels[c].history;
+        delayed[c] = (source >= 0 && source >= forgottenBefore) ? history[static_cast<size_t>(source)] : 0.0f;
+        history.push_back(in[c]);
+    }
+    ++written;
+
+    // Crosstalk, then the character filters
+    float filtered[2] = { delayed[0] + kCrosstalk * delayed[1], delayed[1] + kCrosstalk * delayed[0] };
+    for (int c = 0; c < 2; ++c)
+    {
+        Channel& ch = channels[c];
+        if (quality == Quality::High)
+            filtered[c] = ch.lowPass.processPrecise(ch.highPass.processPrecise(filtered[c]));
+        else
+            filtered[c] = ch.lowPass.process(ch.highPass.process(filtered[c]));
+    }
+
+    // Half-LSB dither (rectangular in Eco, triangular otherwise) and the
+    // -80 dBFS noise floor
+    float levels = static_cast<float>(1 << bitDepth);
+    float ditherAmplitude = 0.5f * (1.0f / levels);
+    float dither[2], noiseFloor[2];
+    if (quality == Quality::Eco)
+    {
+        float a = nextNoise();
+        float b = nextNoise();
+        noiseCounter += kNoiseDraws - 2;
+        dither[0] = a * ditherAmplitude;
+        dither[1] = b * ditherAmplitude;
+        noiseFloor[0] = b * kNoiseFloor;
+        noiseFloor[1] = a * kNoiseFloor;
+    }
+    else
+    {
+        dither[0] = (nextNoise() + nextNoise()) * ditherAmplitude;
+        dither[1] = (nextNoise() + nextNoise()) * ditherAmplitude;
+        noiseFloor[0] = nextNoise() * kNoiseFloor;
+        noiseFloor[1] = nextNoise() * kNoiseFloor;
+    }
+
+    for (int c = 0; c < 2; ++c)
+    {
+        float dithered = filtered[c] + dither[c];
+        float quantized = std::floor(dithered * levels + 0.5f) / levels;
+        channels[c].pending.push_back(quantized + noiseFloor[c]);
+    }
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
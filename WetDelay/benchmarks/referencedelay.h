@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// ReferenceDelay - Plain scalar model of the DelayBuffer signal chain
+//
+// Written for readability, not speed: one host sample at a time through
+// anti-alias -> downsample -> delay -> crosstalk -> 80 Hz HP -> 9 kHz LP
+// -> dither -> quantize + noise floor -> upsample -> reconstruction, with
+// no chunking, tables, SIMD, mono fast path or paged ring. It shares no
+// code with DelayBuffer; only the documented behaviour is the same:
+// - resampler grid: integer phase over the reduced rate ratio
+// - filters keep their memory in double, so tiers can switch per block
+// - noise stream: SplitMix64 over (seed, counter), 6 draws per internal
+//   sample whatever the tier
+// - the ring starts at 4096 frames and grows in whole pages; frames older
+//   than the ring held when it grew read as silence
+// - an internal rate change clears the line and all filter/resampler
+//   memory, but not the noise position
+//
+// Keep this file as it is when optimizing DelayBuffer: equivalencecheck
+// compares the two.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+class ReferenceDelay
+{
+public:
+    enum class Quality { Eco, Standard, High };
+
+    void setNoiseSeed(uint64_t seed) { noiseKey = seed; }
+    void setBitDepth(int bits);
+    void setQuality(Quality newQuality) { quality = newQuality; }
+
+    // Index into {16, 24, 32, 48} kHz; clears the line once prepared
+    void setInternalRate(int rateIndex);
+
+    void prepare(double sampleRate, int maxDelayMs, bool packedLine);
+
+    void processStereo(const float* leftIn, float* leftOut,
+                       const float* rightIn, float* rightOut,
+                       int numSamples, int delayMs);
+
+private:
+    struct OnePole
+    {
+        double coefficient = 0.0;
+        bool highPass = false;
+        double z1 = 0.0;
+        double x1 = 0.0;
+
+        float process(float input);
+        float processPrecise(float input);
+    };
+
+    struct Resampler
+    {
+        int64_t inputStep = 1;
+        int64_t outputStep = 1;
+        int64_t phase = 0;
+        float last = 0.0f;
+        float prev1 = 0.0f;
+        float prev2 = 0.0f;
+
+        float interpolate(int64_t p, float next, bool cubic) const;
+        void push(float sample);
+    };
+
+    struct Channel
+    {
+        OnePole antiAlias, reconstruct, highPass, lowPass;
+        Resampler down, up;
+        std::vector<float> history;  // every internal sample written
+        std::deque<float> pending;   // processed, not yet upsampled
+    };
+
+    void configure();
+    void clearState();
+    float nextNoise();
+    void processInternalFrame(float inL, float inR, int delaySamples);
+
+    Channel channels[2];
+    double hostRate = 44100.0;
+    double internalRate = 24000.0;
+    int rateIndex = 1;
+    int maxDelayMs = 0;
+    int maxSamples = 0;
+    bool packed = false;
+    bool prepared = false;
+    Quality quality = Quality::Standard;
+    int bitDepth = 12;
+
+    // Ring model
+    int64_t written = 0;
+    int64_t forgottenBefore = 0;
+    int capacity = 0;
+
+    uint64_t noiseKey = 0;
+    uint64_t noiseCounter = 0;
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
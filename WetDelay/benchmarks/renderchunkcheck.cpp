@@ -0,0 +1,145 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// renderchunkcheck - Chunked offline renders against one continuous pass
+//
+// Renders a signal once from host sample 0, then again as chunks that each
+// start at a different position the way a host bounces a selection: the
+// engine is cleared, aligned with setRenderPosition() getPrerollSamples()
+// before the chunk, and fed that pre-roll before the chunk itself. Every
+// chunk must match the continuous pass bit for bit, per host rate,
+// internal rate, tier, line format and delay time. Exits non-zero on any
+// mismatch.
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace Yonie;
+
+namespace {
+
+constexpr uint64_t kNoiseSeed = 0x5EED5EED5EED5EEDull;
+constexpr int kMaxDelayMs = 10000;
+constexpr double kSeconds = 4.0;
+constexpr int kPassBlock = 512;    // continuous pass
+constexpr int kChunkBlock = 1000;  // chunks, so block edges differ too
+constexpr double kTwoPi = 6.283185307179586;
+
+const double kHostRates[] = { 44100.0, 48000.0, 96000.0 };
+const int kDelaysMs[] = { 20, 400, 2000 };
+
+// Chunk starts as fractions of the render; the first is inside the
+// pre-roll of a long delay, so its pre-roll is cut short at sample 0
+const double kChunkStarts[] = { 0.01, 0.25, 0.5, 0.77 };
+
+//------------------------------------------------------------------------
+void fillInput(std::vector<float>& left, std::vector<float>& right, double sampleRate)
+{
+    uint32_t state = 12345;
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        float noise = static_cast<float>(state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        double t = static_cast<double>(i) / sampleRate;
+        left[i] = 0.5f * static_cast<float>(std::sin(kTwoPi * 440.0 * t)) + 0.1f * noise;
+        right[i] = 0.4f * static_cast<float>(std::sin(kTwoPi * 1234.5 * t)) - 0.1f * noise;
+    }
+}
+
+//------------------------------------------------------------------------
+void configure(DelayBuffer& buffer, double sampleRate, int rateIndex, int tier, bool packed)
+{
+    buffer.setNoiseSeed(kNoiseSeed);
+    buffer.setChunkSize(DelayBuffer::OFFLINE_CHUNK_SIZE);
+    buffer.setLineFormat(packed ? DelayBuffer::LineFormat::Packed12 : DelayBuffer::LineFormat::Float32);
+    buffer.setInternalRate(rateIndex);
+    buffer.setQuality(static_cast<DelayBuffer::Quality>(tier));
+    buffer.prepare(sampleRate, kMaxDelayMs);
+    buffer.setRenderPosition(0);
+}
+
+//------------------------------------------------------------------------
+void render(DelayBuffer& buffer, const float* inL, const float* inR, float* outL, float* outR,
+            int numSamples, int blockSize, int delayMs)
+{
+    for (int offset = 0; offset < numSamples; offset += blockSize)
+    {
+        int count = std::min(blockSize, numSamples - offset);
+        buffer.processStereo(inL + offset, outL + offset, inR + offset, outR + offset, count, delayMs);
+    }
+}
+
+//------------------------------------------------------------------------
+// One setting; prints and returns the number of chunks that differ
+int checkSetting(double sampleRate, int rateIndex, int tier, bool packed, int delayMs)
+{
+    int numSamples = static_cast<int>(kSeconds * sampleRate);
+    std::vector<float> inL(numSamples), inR(numSamples);
+    fillInput(inL, inR, sampleRate);
+
+    DelayBuffer continuous;
+    configure(continuous, sampleRate, rateIndex, tier, packed);
+    std::vector<float> passL(numSamples), passR(numSamples);
+    render(continuous, inL.data(), inR.data(), passL.data(), passR.data(), numSamples, kPassBlock, delayMs);
+
+    DelayBuffer chunked;
+    configure(chunked, sampleRate, rateIndex, tier, packed);
+    std::vector<float> chunkL(numSamples), chunkR(numSamples);
+
+    int failures = 0;
+    int numChunks = static_cast<int>(std::size(kChunkStarts));
+    for (int c = 0; c < numChunks; ++c)
+    {
+        int start = static_cast<int>(kChunkStarts[c] * numSamples);
+        int end = c + 1 < numChunks ? static_cast<int>(kChunkStarts[c + 1] * numSamples) : numSamples;
+        int prerollStart = std::max(0, start - chunked.getPrerollSamples(delayMs));
+
+        chunked.reset();
+        chunked.setRenderPosition(prerollStart);
+        chunked.preroll(inL.data() + prerollStart, inR.data() + prerollStart, start - prerollStart, delayMs);
+        render(chunked, inL.data() + start, inR.data() + start, chunkL.data() + start, chunkR.data() + start,
+               end - start, kChunkBlock, delayMs);
+
+        size_t bytes = static_cast<size_t>(end - start) * sizeof(float);
+        if (std::memcmp(chunkL.data() + start, passL.data() + start, bytes) != 0
+            || std::memcmp(chunkR.data() + start, passR.data() + start, bytes) != 0)
+        {
+            int first = start;
+            while (first < end && chunkL[first] == passL[first] && chunkR[first] == passR[first])
+                ++first;
+            std::printf("FAILED %6.0f Hz -> %5.0f Hz, tier %d, %s line, %5d ms: chunk at %d "
+                        "differs from sample %d (%g vs %g)\n",
+                        sampleRate, DelayBuffer::INTERNAL_RATES[rateIndex], tier, packed ? "packed" : "float",
+                        delayMs, start, first, chunkL[first], passL[first]);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main()
+{
+    int settings = 0;
+    int failures = 0;
+    for (double sampleRate : kHostRates)
+        for (int rateIndex = 0; rateIndex < DelayBuffer::NUM_INTERNAL_RATES; ++rateIndex)
+            for (int tier = 0; tier < 3; ++tier)
+                for (int packed = 0; packed < 2; ++packed)
+                    for (int delayMs : kDelaysMs)
+                    {
+                        failures += checkSetting(sampleRate, rateIndex, tier, packed != 0, delayMs) != 0;
+                        ++settings;
+                    }
+
+    std::printf("%d of %d settings render identically in chunks\n", settings - failures, settings);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+// stageprofilebench - Per-stage timings of the DelayBuffer chain
+//
+// Built with WETDELAY_PROFILING=1, so DelayBuffer carries its
+// StageProfiler. Renders a few seconds of tone and noise per internal rate
+// and tier in realtime-sized blocks and prints each stage's calls, mean
+// ticks per call and the histogram's median and 99th percentile buckets.
+// Ticks are TSC cycles on x86, nanoseconds elsewhere.
+//------------------------------------------------------------------------
+
+#include "delaybuffer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#if !WETDELAY_PROFILING
+#error "stageprofilebench needs WETDELAY_PROFILING=1"
+#endif
+
+using namespace Yonie;
+
+namespace {
+
+constexpr double kSampleRate = 48000.0;
+constexpr int kBlockSize = 256;
+constexpr int kSeconds = 5;
+constexpr int kDelayMs = 400;
+constexpr double kTwoPi = 6.283185307179586;
+
+const char* const kTierNames[] = { "eco", "standard", "high" };
+
+//------------------------------------------------------------------------
+// Lower edge of the histogram bucket holding the given fraction of calls
+uint64_t percentileTicks(const StageProfile& profile, double fraction)
+{
+    uint64_t target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(profile.calls)));
+    uint64_t seen = 0;
+    for (int b = 0; b < StageProfile::kNumBuckets; ++b)
+    {
+        seen += profile.histogram[b];
+        if (seen >= target && seen > 0)
+            return b == 0 ? 0 : (uint64_t(1) << b);
+    }
+    return 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+int main()
+{
+    int numSamples = static_cast<int>(kSeconds * kSampleRate);
+    std::vector<float> inL(numSamples), inR(numSamples);
+    uint32_t state = 1;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        float noise = static_cast<float>(state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        inL[i] = 0.5f * static_cast<float>(std::sin(kTwoPi * 440.0 * i / kSampleRate)) + 0.1f * noise;
+        inR[i] = 0.4f * static_cast<float>(std::sin(kTwoPi * 1234.5 * i / kSampleRate)) - 0.1f * noise;
+    }
+    std::vector<float> outL(kBlockSize), outR(kBlockSize);
+
+    std::printf("%-8s %-9s %-26s %10s %12s %10s %10s\n",
+                "internal", "tier", "stage", "calls", "ticks/call", "p50", "p99");
+    for (int rateIndex = 0; rateIndex < DelayBuffer::NUM_INTERNAL_RATES; ++rateIndex)
+    {
+        for (int tier = 0; tier < 3; ++tier)
+        {
+            DelayBuffer buffer;
+            buffer.setInternalRate(rateIndex);
+            buffer.setQuality(static_cast<DelayBuffer::Quality>(tier));
+            buffer.prepare(kSampleRate, kDelayMs);
+
+            for (int offset = 0; offset + kBlockSize <= numSamples; offset += kBlockSize)
+                buffer.processStereo(inL.data() + offset, outL.data(), inR.data() + offset, outR.data(),
+                                     kBlockSize, kDelayMs);
+
+            for (int s = 0; s < static_cast<int>(DspStage::Count); ++s)
+            {
+                StageProfile profile;
+                buffer.getProfiler().read(static_cast<DspStage>(s), profile);
+                std::printf("%5.0f Hz %-9s %-26s %10llu %12.1f %10llu %10llu\n",
+                            DelayBuffer::INTERNAL_RATES[rateIndex], kTierNames[tier],
+                            StageProfiler::stageName(static_cast<DspStage>(s)),
+                            static_cast<unsigned long long>(profile.calls),
+                            profile.calls ? static_cast<double>(profile.ticks) / profile.calls : 0.0,
+                            static_cast<unsigned long long>(percentileTicks(profile, 0.5)),
+                            static_cast<unsigned long long>(percentileTicks(profile, 0.99)));
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "backplateview.h"
+#include "vstgui/lib/coffscreencontext.h"
+
+using namespace VSTGUI;
+
+namespace Yonie {
+
+// Resource shipped next to the uidesc
+static const char* kBackplateResource = "backplate.png";
+
+int BackplateCache::refs = 0;
+SharedPointer<CBitmap> BackplateCache::source;
+std::vector<BackplateCache::Variant> BackplateCache::variants;
+
+//------------------------------------------------------------------------
+// BackplateCache Implementation
+//------------------------------------------------------------------------
+void BackplateCache::retain()
+{
+    ++refs;
+}
+
+//------------------------------------------------------------------------
+void BackplateCache::release()
+{
+    if (refs > 0 && --refs == 0)
+    {
+        variants.clear();
+        source = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------
+SharedPointer<CBitmap> BackplateCache::get(const CPoint& size, double scaleFactor)
+{
+    for (const Variant& variant : variants)
+    {
+        if (variant.size == size && variant.scaleFactor == scaleFactor)
+            return variant.bitmap;
+    }
+
+    auto bitmap = renderVariant(size, scaleFactor);
+    if (bitmap && refs > 0)
+        variants.push_back({size, scaleFactor, bitmap});
+    return bitmap;
+}
+
+//------------------------------------------------------------------------
+int BackplateCache::getNumVariants()
+{
+    return static_cast<int>(variants.size());
+}
+
+//------------------------------------------------------------------------
+SharedPointer<CBitmap> BackplateCache::renderVariant(const CPoint& size, double scaleFactor)
+{
+    if (!source)
+    {
+        source = makeOwned<CBitmap>(CResourceDescription(kBackplateResource));
+        if (!source->getPlatformBitmap())
+        {
+            source = nullptr;
+            return nullptr;
+        }
+    }
+
+    // Drawn unscaled from the top left, as a container background would be
+    auto offscreen = COffscreenContext::create(size, scaleFactor);
+    if (!offscreen)
+        return source;
+
+    offscreen->beginDraw();
+    offscreen->drawBitmap(source, CRect(0, 0, size.x, size.y));
+    offscreen->endDraw();
+    return offscreen->getBitmap();
+}
+
+//------------------------------------------------------------------------
+// BackplateView Implementation
+//------------------------------------------------------------------------
+BackplateView::BackplateView(const CRect& size)
+    : CView(size)
+{
+    setMouseEnabled(false);
+    setWantsFocus(false);
+}
+
+//------------------------------------------------------------------------
+void BackplateView::draw(CDrawContext* context)
+{
+    drawRect(context, getViewSize());
+}
+
+//------------------------------------------------------------------------
+void BackplateView::drawRect(CDrawContext* context, const CRect& updateRect)
+{
+    CRect viewSize = getViewSize();
+    auto bitmap = BackplateCache::get(viewSize.getSize(), context->getScaleFactor());
+    if (bitmap)
+    {
+        CRect area = updateRect;
+        area.bound(viewSize);
+        CPoint offset(area.left - viewSize.left, area.top - viewSize.top);
+        context->drawBitmap(bitmap, area, offset);
+    }
+    setDirty(false);
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
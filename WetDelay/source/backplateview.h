@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "vstgui/lib/cview.h"
+#include "vstgui/lib/cdrawcontext.h"
+#include "vstgui/lib/cbitmap.h"
+#include <vector>
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// BackplateCache - Process-wide backplate shared by every editor
+// The PNG is decoded once; each content scale factor in use gets its own
+// copy pre-rendered at device resolution, so drawing is a plain blit.
+// Counted: the bitmaps live while anyone holds a reference, so reopening
+// an editor never decodes again. UI thread only, like the rest of VSTGUI.
+//------------------------------------------------------------------------
+class BackplateCache
+{
+public:
+    static void retain();
+    static void release();
+
+    // Backplate cropped to 'size' and rendered at 'scaleFactor', or nullptr
+    // if the resource can't be loaded
+    static VSTGUI::SharedPointer<VSTGUI::CBitmap> get(const VSTGUI::CPoint& size, double scaleFactor);
+
+    // Number of pre-rendered variants (for diagnostics)
+    static int getNumVariants();
+
+private:
+    struct Variant
+    {
+        VSTGUI::CPoint size;
+        double scaleFactor;
+        VSTGUI::SharedPointer<VSTGUI::CBitmap> bitmap;
+    };
+
+    static VSTGUI::SharedPointer<VSTGUI::CBitmap> renderVariant(const VSTGUI::CPoint& size, double scaleFactor);
+
+    static int refs;
+    static VSTGUI::SharedPointer<VSTGUI::CBitmap> source;
+    static std::vector<Variant> variants;
+};
+
+//------------------------------------------------------------------------
+// BackplateView - Draws the shared backplate
+// Replaces the template's background bitmap, which every editor would
+// decode and scale on its own. Only the invalidated area is blitted.
+//------------------------------------------------------------------------
+class BackplateView : public VSTGUI::CView
+{
+public:
+    BackplateView(const VSTGUI::CRect& size);
+    ~BackplateView() override = default;
+
+    // CView overrides
+    void draw(VSTGUI::CDrawContext* context) override;
+    void drawRect(VSTGUI::CDrawContext* context, const VSTGUI::CRect& updateRect) override;
+
+    CLASS_METHODS(BackplateView, CView)
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
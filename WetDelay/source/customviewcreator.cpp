@@ -11,14 +11,15 @@ using namespace VSTGUI;
 namespace Yonie {
 
 // Attribute names
-static const std::string kAttrNumSegments = "num-segments";
-static const std::string kAttrSegmentGap = "segment-gap";
-static const std::string kAttrHorizontal = "horizontal";
-static const std::string kAttrButtonIndex = "button-index";
-static const std::string kAttrActiveColor = "active-color";
-static const std::string kAttrInactiveColor = "inactive-color";
-static const std::string kAttrFrameColor = "frame-color";
-static const std::string kAttrFrameWidth = "frame-width";
+static const char* const kAttrNumSegments = "num-segments";
+static const char* const kAttrSegmentGap = "segment-gap";
+static const char* const kAttrHorizontal = "horizontal";
+static const char* const kAttrBitmapCache = "bitmap-cache";
+static const char* const kAttrButtonIndex = "button-index";
+static const char* const kAttrActiveColor = "active-color";
+static const char* const kAttrInactiveColor = "inactive-color";
+static const char* const kAttrFrameColor = "frame-color";
+static const char* const kAttrFrameWidth = "frame-width";
 
 //------------------------------------------------------------------------
 // LEDMeterViewCreator Implementation
@@ -56,6 +57,9 @@ bool LEDMeterViewCreator::apply(CView* view, const UIAttributes& attributes,
     if (attributes.getBooleanAttribute(kAttrHorizontal, boolValue))
         meterView->setHorizontal(boolValue);
     
+    if (attributes.getBooleanAttribute(kAttrBitmapCache, boolValue))
+        meterView->setUseBitmapCache(boolValue);
+    
     return true;
 }
 
@@ -65,6 +69,7 @@ bool LEDMeterViewCreator::getAttributeNames(StringList& attributeNames) const
     attributeNames.emplace_back(kAttrNumSegments);
     attributeNames.emplace_back(kAttrSegmentGap);
     attributeNames.emplace_back(kAttrHorizontal);
+    attributeNames.emplace_back(kAttrBitmapCache);
     return true;
 }
 
@@ -75,7 +80,7 @@ IViewCreator::AttrType LEDMeterViewCreator::getAttributeType(const std::string&
         return kIntegerType;
     if (attributeName == kAttrSegmentGap)
         return kFloatType;
-    if (attributeName == kAttrHorizontal)
+    if (attributeName == kAttrHorizontal || attributeName == kAttrBitmapCache)
         return kBooleanType;
     return kUnknownType;
 }
@@ -105,6 +110,11 @@ bool LEDMeterViewCreator::getAttributeValue(CView* view, const std::string& attr
         stringValue = "true";
         return true;
     }
+    if (attributeName == kAttrBitmapCache)
+    {
+        stringValue = meterView->getUseBitmapCache() ? "true" : "false";
+        return true;
+    }
     return false;
 }
 
@@ -336,18 +346,31 @@ bool DelayTimeButtonGroupCreator::getAttributeValue(CView* view, const std::stri
 }
 
 //------------------------------------------------------------------------
-// Static instances to auto-register
+// BackplateViewCreator Implementation
+//------------------------------------------------------------------------
+BackplateViewCreator::BackplateViewCreator()
+{
+    UIViewFactory::registerViewCreator(*this);
+}
+
 //------------------------------------------------------------------------
-static LEDMeterViewCreator gLEDMeterViewCreator;
-static ButtonLEDIndicatorCreator gButtonLEDIndicatorCreator;
-static ButtonSelectionFrameCreator gButtonSelectionFrameCreator;
-static DelayTimeButtonGroupCreator gDelayTimeButtonGroupCreator;
+CView* BackplateViewCreator::create(const UIAttributes& attributes,
+                                     const IUIDescription* description) const
+{
+    CRect size(0, 0, 702, 640);
+    return new BackplateView(size);
+}
 
 //------------------------------------------------------------------------
 void registerCustomViews()
 {
-    // Views are auto-registered via static initialization
-    // This function can be called to ensure the translation unit is linked
+    // Created on first use rather than at module load, so hosts that only
+    // scan the plug-in or render audio never touch the view factory
+    static LEDMeterViewCreator ledMeterViewCreator;
+    static ButtonLEDIndicatorCreator buttonLEDIndicatorCreator;
+    static ButtonSelectionFrameCreator buttonSelectionFrameCreator;
+    static DelayTimeButtonGroupCreator delayTimeButtonGroupCreator;
+    static BackplateViewCreator backplateViewCreator;
 }
 
 //------------------------------------------------------------------------
@@ -13,6 +13,7 @@
 #include "buttonledindicator.h"
 #include "buttonselectionframe.h"
 #include "delaytimebuttonsgroup.h"
+#include "backplateview.h"
 
 namespace Yonie {
 
@@ -117,7 +118,25 @@ public:
 };
 
 //------------------------------------------------------------------------
-// Register custom views - call this during plugin initialization
+// BackplateViewCreator - Factory for creating BackplateView
+//------------------------------------------------------------------------
+class BackplateViewCreator : public VSTGUI::ViewCreatorAdapter
+{
+public:
+    BackplateViewCreator();
+    
+    // IViewCreator
+    VSTGUI::IdStringPtr getViewName() const override { return "BackplateView"; }
+    VSTGUI::IdStringPtr getBaseViewName() const override { return "CView"; }
+    VSTGUI::UTF8StringPtr getDisplayName() const override { return "Backplate View"; }
+    
+    VSTGUI::CView* create(const VSTGUI::UIAttributes& attributes,
+                          const VSTGUI::IUIDescription* description) const override;
+};
+
+//------------------------------------------------------------------------
+// Register custom views with the UIViewFactory - call before creating an
+// editor; later calls do nothing
 //------------------------------------------------------------------------
 void registerCustomViews();
 
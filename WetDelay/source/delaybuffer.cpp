@@ -5,17 +5,180 @@
 #include "delaybuffer.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WETDELAY_SSE2 1
+#else
+#define WETDELAY_SSE2 0
+#endif
 
 namespace Yonie {
 
+//------------------------------------------------------------------------
+// 12-bit line helpers
+// Full scale +-1.0 maps to -2048..2047. Rounding is to nearest (ties to
+// even) on both the SIMD and scalar paths.
+//------------------------------------------------------------------------
+static constexpr float LINE_SCALE = 2048.0f;
+static constexpr float LINE_MIN = -2048.0f;
+static constexpr float LINE_MAX = 2047.0f;
+
+static void quantizeToLine(const float* input, int16_t* output, int count)
+{
+    int i = 0;
+#if WETDELAY_SSE2
+    const __m128 scale = _mm_set1_ps(LINE_SCALE);
+    const __m128 lo = _mm_set1_ps(LINE_MIN);
+    const __m128 hi = _mm_set1_ps(LINE_MAX);
+    for (; i + 8 <= count; i += 8)
+    {
+        // Clamp before converting: out-of-range floats convert to INT_MIN
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i), scale), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), lo), hi);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        // Bound first, like the SIMD path: NaN compares false and clamps to
+        // LINE_MIN instead of reaching the integer conversion
+        float v = std::min(LINE_MAX, std::max(LINE_MIN, input[i] * LINE_SCALE));
+        output[i] = static_cast<int16_t>(std::nearbyint(v));
+    }
+}
+
+static void lineToFloat(const int16_t* input, float* output, int count)
+{
+    constexpr float INV_SCALE = 1.0f / LINE_SCALE;
+    int i = 0;
+#if WETDELAY_SSE2
+    const __m128 scale = _mm_set1_ps(INV_SCALE);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        // Sign-extend 16 -> 32 bit
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < count; ++i)
+        output[i] = static_cast<float>(input[i]) * INV_SCALE;
+}
+
+//------------------------------------------------------------------------
+void quantizeBlockToLevels(float* samples, const float* noiseFloor, int count,
+                           float levels, float invLevels)
+{
+    int i = 0;
+#if WETDELAY_SSE2
+    const __m128 scale = _mm_set1_ps(levels);
+    const __m128 invScale = _mm_set1_ps(invLevels);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 hi = _mm_set1_ps(16777216.0f);
+    const __m128 lo = _mm_set1_ps(-16777216.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        // Operand order keeps the scalar clamp's NaN behaviour
+        __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(samples + i), scale), half);
+        scaled = _mm_min_ps(_mm_max_ps(scaled, lo), hi);
+        
+        // Truncate, then step down where truncation rounded up (negatives);
+        // the compare mask is -1 in those lanes
+        __m128i truncated = _mm_cvttps_epi32(scaled);
+        __m128 below = _mm_cmplt_ps(scaled, _mm_cvtepi32_ps(truncated));
+        __m128i floored = _mm_add_epi32(truncated, _mm_castps_si128(below));
+        
+        __m128 quantized = _mm_mul_ps(_mm_cvtepi32_ps(floored), invScale);
+        _mm_storeu_ps(samples + i, _mm_add_ps(quantized, _mm_loadu_ps(noiseFloor + i)));
+    }
+#endif
+    for (; i < count; ++i)
+        samples[i] = quantizeToLevels(samples[i], levels, invLevels) + noiseFloor[i];
+}
+
+// Stereo frame = 3 bytes: L[7:0], R[3:0]L[11:8], R[11:4]
+static void packFrames(const int16_t* left, const int16_t* right, uint8_t* dst, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uint16_t l = static_cast<uint16_t>(left[i]) & 0x0FFF;
+        uint16_t r = static_cast<uint16_t>(right[i]) & 0x0FFF;
+        dst[0] = static_cast<uint8_t>(l);
+        dst[1] = static_cast<uint8_t>((l >> 8) | (r << 4));
+        dst[2] = static_cast<uint8_t>(r >> 4);
+        dst += 3;
+    }
+}
+
+static void unpackFrames(const uint8_t* src, int16_t* left, int16_t* right, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uint16_t l = static_cast<uint16_t>(src[0] | ((src[1] & 0x0F) << 8));
+        uint16_t r = static_cast<uint16_t>((src[1] >> 4) | (src[2] << 4));
+        // Sign-extend 12 -> 16 bit
+        left[i] = static_cast<int16_t>(static_cast<int16_t>(l << 4) >> 4);
+        right[i] = static_cast<int16_t>(static_cast<int16_t>(r << 4) >> 4);
+        src += 3;
+    }
+}
+
 //------------------------------------------------------------------------
 DelayBuffer::DelayBuffer()
-: writePos(0)
+: useHugePages(false)
+, internalRateIndex(DEFAULT_INTERNAL_RATE)
+, internalRate(INTERNAL_RATES[DEFAULT_INTERNAL_RATE])
+, lineFormat(LineFormat::Float32)
+, requestedLineFormat(LineFormat::Float32)
+, writePos(0)
+, lineLength(0)
+, validFrames(0)
 , maxSamples(0)
+, deferLineCommit(false)
+, lineRequest(0)
+, lineReady(0)
+, lineRequestSeq(0)
+, lineUsableFrames(0)
+, ringTarget(0)
+, stageState(kStageEmpty)
+, stagedLength(0)
+, stagedFrames(0)
+, stagedRateIndex(DEFAULT_INTERNAL_RATE)
+, captureEpoch(0)
+, captureEnabled(false)
+, captureCurrent(false)
+, captureUsableFrames(0)
+, captureSlot(-1)
+, captureLength(0)
+, captureValid(0)
+, captureDone(0)
+, captureStart(0)
+, captureChecked(0)
+, lineWritten(0)
+, captureSerial(0)
+, prepared(false)
+, monoFrames(0)
+, preparedDelayMs(0)
 , hostSampleRate(44100.0)
-, rng(std::random_device{}())
-, ditherDist(-1.0f, 1.0f)  // TPDF dither: uniform -1 to +1
+, upsampleCarry(0)
+, quality(Quality::Standard)
+, requestedQuality(Quality::Standard)
+, bitDepth(DEFAULT_BIT_DEPTH)
+, quantizeLevels(static_cast<float>(1 << DEFAULT_BIT_DEPTH))
+, invQuantizeLevels(1.0f / static_cast<float>(1 << DEFAULT_BIT_DEPTH))
+, chunkSize(REALTIME_CHUNK_SIZE)
+, requestedChunkSize(REALTIME_CHUNK_SIZE)
 {
+    std::random_device device;
+    noise.seed((static_cast<uint64_t>(device()) << 32) | device());
 }
 
 //------------------------------------------------------------------------
@@ -26,45 +189,104 @@ DelayBuffer::~DelayBuffer()
 //------------------------------------------------------------------------
 void DelayBuffer::prepare(double sampleRate, int maxDelayMs)
 {
+    // Unprepared until the line has its first page; if anything below
+    // throws std::bad_alloc, processStereo stays a no-op
+    prepared = false;
+    lineLength = 0;
     hostSampleRate = sampleRate;
+    preparedDelayMs = maxDelayMs;
     
-    // Calculate max samples at INTERNAL 24 kHz rate
-    maxSamples = static_cast<int>(maxDelayMs * INTERNAL_SAMPLE_RATE / 1000.0);
-    
-    // Allocate main delay buffers (at internal 24 kHz rate)
-    bufferL.resize(maxSamples, 0.0f);
-    bufferR.resize(maxSamples, 0.0f);
+    // Calculate max samples at the internal rate; storage is sized for the
+    // highest rate so the rate can change without allocating
+    constexpr double MAX_INTERNAL_RATE = INTERNAL_RATES[NUM_INTERNAL_RATES - 1];
+    internalRate = INTERNAL_RATES[internalRateIndex];
+    maxSamples = static_cast<int>(maxDelayMs * internalRate / 1000.0);
+    int reservedSamples = static_cast<int>(maxDelayMs * MAX_INTERNAL_RATE / 1000.0);
     
+    lineFormat = requestedLineFormat;
     writePos = 0;
     
+#if WETDELAY_PROFILING
+    profiler.reset();
+#endif
+    
     // Calculate max block size at internal rate
-    // Assuming max 4096 samples at host rate, calculate equivalent at internal rate
-    int maxInternalBlockSize = static_cast<int>(4096 * INTERNAL_SAMPLE_RATE / sampleRate) + 16;
-    
-    // Allocate temporary buffers for resampling
-    tempDownL.resize(maxInternalBlockSize, 0.0f);
-    tempDownR.resize(maxInternalBlockSize, 0.0f);
-    tempDelayedL.resize(maxInternalBlockSize, 0.0f);
-    tempDelayedR.resize(maxInternalBlockSize, 0.0f);
-    
-    // Anti-aliasing filter before downsampling (at HOST rate)
-    // Cut at 10 kHz to prevent aliasing when downsampling to 24 kHz
-    antiAliasL.setCoefficients(sampleRate, ANTI_ALIAS_FREQ, OnePoleFilter::Type::LowPass);
-    antiAliasR.setCoefficients(sampleRate, ANTI_ALIAS_FREQ, OnePoleFilter::Type::LowPass);
-    
-    // Reconstruction filter after upsampling (at HOST rate)
-    // Smooths out the stepped output
-    reconstructL.setCoefficients(sampleRate, ANTI_ALIAS_FREQ, OnePoleFilter::Type::LowPass);
-    reconstructR.setCoefficients(sampleRate, ANTI_ALIAS_FREQ, OnePoleFilter::Type::LowPass);
-    
-    // Initialize character filters (at INTERNAL 24 kHz rate)
-    // High-pass filter: 1st-order (6 dB/oct) @ 80 Hz
-    highPassL.setCoefficients(INTERNAL_SAMPLE_RATE, HIGH_PASS_FREQ, OnePoleFilter::Type::HighPass);
-    highPassR.setCoefficients(INTERNAL_SAMPLE_RATE, HIGH_PASS_FREQ, OnePoleFilter::Type::HighPass);
-    
-    // Low-pass filter: 1st-order (6 dB/oct) @ 9 kHz
-    lowPassL.setCoefficients(INTERNAL_SAMPLE_RATE, LOW_PASS_FREQ, OnePoleFilter::Type::LowPass);
-    lowPassR.setCoefficients(INTERNAL_SAMPLE_RATE, LOW_PASS_FREQ, OnePoleFilter::Type::LowPass);
+    // processStereo never hands more than chunkSize host samples to a sub-block
+    chunkSize = requestedChunkSize;
+    size_t internalBlock = static_cast<size_t>(chunkSize * MAX_INTERNAL_RATE / sampleRate) + 16;
+    
+    // Lay out the per-block scratch in one arena so the hot working set
+    // is contiguous. The delayed buffers also hold the upsampler carry at
+    // the front.
+    bool packed = (lineFormat == LineFormat::Packed12);
+    size_t quantSize = packed ? internalBlock : 0;
+    
+    arena.beginLayout();
+    size_t downLOffset = arena.reserve(internalBlock * sizeof(float));
+    size_t downROffset = arena.reserve(internalBlock * sizeof(float));
+    size_t delayedLOffset = arena.reserve((internalBlock + DelayLineSnapshot::kMaxCarry) * sizeof(float));
+    size_t delayedROffset = arena.reserve((internalBlock + DelayLineSnapshot::kMaxCarry) * sizeof(float));
+    size_t quantLOffset = arena.reserve(quantSize * sizeof(int16_t));
+    size_t quantROffset = arena.reserve(quantSize * sizeof(int16_t));
+    size_t unpackLOffset = arena.reserve(quantSize * sizeof(int16_t));
+    size_t unpackROffset = arena.reserve(quantSize * sizeof(int16_t));
+    arena.allocate(useHugePages);
+    
+    tempDownL = arena.span<float>(downLOffset, internalBlock);
+    tempDownR = arena.span<float>(downROffset, internalBlock);
+    tempDelayedL = arena.span<float>(delayedLOffset, internalBlock + DelayLineSnapshot::kMaxCarry);
+    tempDelayedR = arena.span<float>(delayedROffset, internalBlock + DelayLineSnapshot::kMaxCarry);
+    tempQuantL = arena.span<int16_t>(quantLOffset, quantSize);
+    tempQuantR = arena.span<int16_t>(quantROffset, quantSize);
+    tempUnpackL = arena.span<int16_t>(unpackLOffset, quantSize);
+    tempUnpackR = arena.span<int16_t>(unpackROffset, quantSize);
+    
+    // Share filter coefficients and resampler tables with every other
+    // instance at this rate. The new references are taken before the old
+    // ones drop, so re-preparing at the same rate never rebuilds them.
+    for (int rate = 0; rate < NUM_INTERNAL_RATES; ++rate)
+        for (int tier = 0; tier < NUM_TIERS; ++tier)
+            tables[rate][tier] = DspTableCache::acquire(sampleRate, INTERNAL_RATES[rate], tier,
+                                                        &DelayBuffer::buildTables);
+    
+    // Address space for the maximum delay at any internal rate; only the
+    // first page is committed (and touched) here
+    size_t maxFrames = static_cast<size_t>(std::max(reservedSamples, 0));
+    size_t lineBytes = maxFrames * (packed ? 3 : sizeof(float));
+    // The spare and capture pages get the same address space, and likewise
+    // commit only what they hold
+    VirtualBlock* blocks[] = { &lineMemoryL, &lineMemoryR, &stagedMemoryL, &stagedMemoryR,
+                               &captureSlots[0].memoryL, &captureSlots[0].memoryR,
+                               &captureSlots[1].memoryL, &captureSlots[1].memoryR };
+    static_assert(NUM_CAPTURE_SLOTS == 2, "capture slots are listed above");
+    for (int i = 0; i < 8; i += 2)
+    {
+        blocks[i]->reserve(lineBytes, useHugePages);
+        if (packed)
+            blocks[i + 1]->release();
+        else
+            blocks[i + 1]->reserve(lineBytes, useHugePages);
+    }
+    stageState.store(kStageEmpty);
+    for (CaptureSlot& slot : captureSlots)
+        slot.state.store(kSlotEmpty);
+    captureSlot = -1;
+    captureCurrent = false;
+    captureUsableFrames = 0;
+    lineWritten = 0;
+    captureChecked = 0;
+    validFrames = 0;
+    ringTarget = 0;
+    lineRequestSeq = 0;
+    lineRequest.store(0);
+    lineReady.store(0);
+    lineUsableFrames = 0;
+    updateLineSpans();
+    
+    // The last step that can fail, so any failure leaves lineLength at 0
+    if (!growLineNow(LINE_PAGE_FRAMES))
+        throw std::bad_alloc();
+    monoFrames = lineLength;
     
     // Reset all filter states
     antiAliasL.reset();
@@ -77,87 +299,638 @@ void DelayBuffer::prepare(double sampleRate, int maxDelayMs)
     lowPassR.reset();
     
     // Reset resamplers
+    applyInternalRate();  // Sets ratios, filter coefficients and resampler tables
     downsamplerL.reset();
     downsamplerR.reset();
     upsamplerL.reset();
     upsamplerR.reset();
+    upsampleCarry = 0;
+    noise.setPosition(0);
+    prepared = true;
 }
 
 //------------------------------------------------------------------------
-void DelayBuffer::processStereo(float* leftIn, float* leftOut,
-                                float* rightIn, float* rightOut,
+void DelayBuffer::processStereo(const float* leftIn, float* leftOut,
+                                const float* rightIn, float* rightOut,
                                 int numSamples, int delayMs)
 {
-    if (bufferL.empty() || bufferR.empty())
+    if (lineLength <= 0)
         return;
+    pollLine();
     
     // Calculate delay in samples at INTERNAL rate
     int delaySamples = msToSamples(delayMs);
     delaySamples = std::max(1, std::min(delaySamples, maxSamples - 1));
     
-    // Step 1: Anti-alias filter the input (at host rate)
-    std::vector<float> filteredInL(numSamples);
-    std::vector<float> filteredInR(numSamples);
-    for (int i = 0; i < numSamples; ++i)
+    // Hold more history on first use of a longer delay
+    if (delaySamples >= lineLength)
+        growLine(delaySamples + 1);
+    
+    // Output is independent of block size, so any block splits exactly
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
     {
-        filteredInL[i] = antiAliasL.process(leftIn[i]);
-        filteredInR[i] = antiAliasR.process(rightIn[i]);
+        int count = std::min(chunkSize, numSamples - offset);
+        processChunk(leftIn + offset, leftOut + offset,
+                     rightIn + offset, rightOut + offset,
+                     count, delaySamples);
     }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::processChunk(const float* leftIn, float* leftOut,
+                               const float* rightIn, float* rightOut,
+                               int numSamples, int delaySamples)
+{
+    if (requestedQuality != quality)
+        applyQuality();
     
-    // Step 2: Downsample to internal 24 kHz rate
-    int internalSamples = static_cast<int>(numSamples * INTERNAL_SAMPLE_RATE / hostSampleRate) + 1;
-    internalSamples = std::min(internalSamples, static_cast<int>(tempDownL.size()));
+    // Identical channels (or a mono input passed as both) run the shared
+    // part of the chain once
+    bool mono = (leftIn == rightIn
+                 || std::memcmp(leftIn, rightIn, static_cast<size_t>(numSamples) * sizeof(float)) == 0)
+                && channelsShareState(delaySamples);
     
-    int actualDownL = downsamplerL.downsample(filteredInL.data(), numSamples,
-                                               tempDownL.data(), internalSamples,
-                                               hostSampleRate, INTERNAL_SAMPLE_RATE);
-    int actualDownR = downsamplerR.downsample(filteredInR.data(), numSamples,
-                                               tempDownR.data(), internalSamples,
-                                               hostSampleRate, INTERNAL_SAMPLE_RATE);
+    WETDELAY_PROFILE_START();
     
-    int actualInternal = std::min(actualDownL, actualDownR);
+    // Steps 1+2: Anti-alias filter the input (at host rate) and downsample
+    // to the internal rate in one pass
+    // The exact count follows from the resampler phase; both channels agree
+    int internalSamples = downsamplerL.outputsFor(numSamples);
+    internalSamples = std::min(internalSamples, static_cast<int>(tempDownL.size()));
+    
+    int actualInternal = downsamplerL.downsample(leftIn, numSamples,
+                                                 tempDownL.data(), internalSamples, antiAliasL);
+    if (!mono)
+    {
+        int actualDownR = downsamplerR.downsample(rightIn, numSamples,
+                                                   tempDownR.data(), internalSamples, antiAliasR);
+        actualInternal = std::min(actualInternal, actualDownR);
+    }
+    WETDELAY_PROFILE_STAGE(Downsample);
     
     // Step 3: Process through delay line at internal rate
-    for (int i = 0; i < actualInternal; ++i)
+    // Authentic mode quantizes the input to the 12-bit line on the way in
+    if (lineFormat == LineFormat::Packed12)
+    {
+        quantizeToLine(tempDownL.data(), tempQuantL.data(), actualInternal);
+        lineToFloat(tempQuantL.data(), tempDownL.data(), actualInternal);
+        if (mono)
+        {
+            std::copy(tempQuantL.begin(), tempQuantL.begin() + actualInternal, tempQuantR.begin());
+        }
+        else
+        {
+            quantizeToLine(tempDownR.data(), tempQuantR.data(), actualInternal);
+            lineToFloat(tempQuantR.data(), tempDownR.data(), actualInternal);
+        }
+    }
+    
+    // The line keeps both channels, so it is ready for stereo input again
+    if (mono)
+        std::copy(tempDownL.begin(), tempDownL.begin() + actualInternal, tempDownR.begin());
+    
+    // Output lands after the samples the upsamplers did not consume last block
+    float* delayedL = tempDelayedL.data() + upsampleCarry;
+    float* delayedR = tempDelayedR.data() + upsampleCarry;
+    readLine(delayedL, delayedR, actualInternal, delaySamples);
+    writeLine(actualInternal);
+    trackMonoFrames(actualInternal, mono);
+    WETDELAY_PROFILE_STAGE(DelayLine);
+    
+    switch (quality)
     {
-        processInternalSample(tempDownL[i], tempDownR[i],
-                              tempDelayedL[i], tempDelayedR[i],
-                              delaySamples);
+        case Quality::Eco:
+            if (mono)
+                processCharacterMono<Quality::Eco>(delayedL, delayedR, actualInternal);
+            else
+                processCharacter<Quality::Eco>(delayedL, delayedR, actualInternal);
+            break;
+        case Quality::Standard:
+            if (mono)
+                processCharacterMono<Quality::Standard>(delayedL, delayedR, actualInternal);
+            else
+                processCharacter<Quality::Standard>(delayedL, delayedR, actualInternal);
+            break;
+        case Quality::High:
+            if (mono)
+                processCharacterMono<Quality::High>(delayedL, delayedR, actualInternal);
+            else
+                processCharacter<Quality::High>(delayedL, delayedR, actualInternal);
+            break;
     }
     
-    // Step 4: Upsample back to host rate
-    upsamplerL.upsample(tempDelayedL.data(), actualInternal,
-                        leftOut, numSamples,
-                        INTERNAL_SAMPLE_RATE, hostSampleRate);
-    upsamplerR.upsample(tempDelayedR.data(), actualInternal,
-                        rightOut, numSamples,
-                        INTERNAL_SAMPLE_RATE, hostSampleRate);
+    quantizeBlock(delayedL, delayedR, actualInternal);
     
-    // Step 5: Reconstruction filter (smooths stepped output)
-    for (int i = 0; i < numSamples; ++i)
+    // The right channel's shared-path state follows the left one
+    if (mono)
     {
-        leftOut[i] = reconstructL.process(leftOut[i]);
-        rightOut[i] = reconstructR.process(rightOut[i]);
+        antiAliasR.copyStateFrom(antiAliasL);
+        downsamplerR.copyStateFrom(downsamplerL);
+        highPassR.copyStateFrom(highPassL);
+        lowPassR.copyStateFrom(lowPassL);
     }
+    WETDELAY_PROFILE_STAGE(Character);
+    
+    // Steps 4+5: Upsample back to host rate and run the reconstruction
+    // filter (smooths stepped output) in one pass
+    int available = upsampleCarry + actualInternal;
+    int consumed = upsamplerL.upsample(tempDelayedL.data(), available,
+                                       leftOut, numSamples, reconstructL);
+    upsamplerR.upsample(tempDelayedR.data(), available,
+                        rightOut, numSamples, reconstructR);
+    
+    // Carry the unconsumed tail (at most one sample) into the next block
+    upsampleCarry = std::min(available - consumed, static_cast<int>(DelayLineSnapshot::kMaxCarry));
+    std::copy(tempDelayedL.begin() + consumed, tempDelayedL.begin() + consumed + upsampleCarry, tempDelayedL.begin());
+    std::copy(tempDelayedR.begin() + consumed, tempDelayedR.begin() + consumed + upsampleCarry, tempDelayedR.begin());
+    WETDELAY_PROFILE_STAGE(Upsample);
 }
 
 //------------------------------------------------------------------------
-void DelayBuffer::processInternalSample(float inputL, float inputR,
-                                        float& outputL, float& outputR,
-                                        int delaySamples)
+void DelayBuffer::readLine(float* outL, float* outR, int count, int delaySamples)
 {
-    // Calculate read position
-    int readPos = writePos - delaySamples;
+    // Reading before writing the block: frame j is delaySamples behind
+    // frame j of this block, so once j >= delaySamples it is block input
+    int fromLine = std::min(count, delaySamples);
+    
+    // Frames from before the line last forgot its history are silence
+    int silent = std::min(fromLine, std::max(0, delaySamples - validFrames));
+    std::fill(outL, outL + silent, 0.0f);
+    std::fill(outR, outR + silent, 0.0f);
+    
+    int readPos = writePos - delaySamples + silent;
     if (readPos < 0)
-        readPos += maxSamples;
+        readPos += lineLength;
+    readLineSpan(readPos, outL + silent, outR + silent, fromLine - silent);
     
-    // Write input to buffer
-    bufferL[writePos] = inputL;
-    bufferR[writePos] = inputR;
+    std::copy(tempDownL.begin(), tempDownL.begin() + (count - fromLine), outL + fromLine);
+    std::copy(tempDownR.begin(), tempDownR.begin() + (count - fromLine), outR + fromLine);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::writeLine(int count)
+{
+    // A deferred growth takes effect where the write reaches the end of
+    // the ring: instead of wrapping it carries on into the new pages, so
+    // no frame has to move
+    int offset = 0;
+    if (ringTarget > lineLength && lineUsableFrames >= ringTarget && writePos + count >= lineLength)
+    {
+        offset = lineLength - writePos;
+        appendLine(0, offset);
+        extendRing(ringTarget);
+    }
+    appendLine(offset, count - offset);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::appendLine(int offset, int count)
+{
+    // A block longer than the ring (offline chunks with a short maximum
+    // delay) leaves only its newest lineLength frames
+    int skip = std::max(0, count - lineLength);
+    int first = offset + skip;
+    writeLineSpan((writePos + skip) % lineLength,
+                  tempDownL.data() + first, tempDownR.data() + first,
+                  tempQuantL.data() + first, tempQuantR.data() + first, count - skip);
+    
+    // Advance write position
+    writePos = (writePos + count) % lineLength;
+    validFrames = std::min(validFrames + count, lineLength);
+    lineWritten += count;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::readLineSpan(int pos, float* outL, float* outR, int count)
+{
+    while (count > 0)
+    {
+        int run = std::min(count, lineLength - pos);
+        if (lineFormat == LineFormat::Packed12)
+        {
+            unpackFrames(packedBuffer.data() + static_cast<size_t>(pos) * 3,
+                         tempUnpackL.data(), tempUnpackR.data(), run);
+            lineToFloat(tempUnpackL.data(), outL, run);
+            lineToFloat(tempUnpackR.data(), outR, run);
+        }
+        else
+        {
+            std::copy(bufferL.begin() + pos, bufferL.begin() + pos + run, outL);
+            std::copy(bufferR.begin() + pos, bufferR.begin() + pos + run, outR);
+        }
+        outL += run;
+        outR += run;
+        count -= run;
+        pos = 0;
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::writeLineSpan(int pos, const float* inL, const float* inR,
+                                const int16_t* quantL, const int16_t* quantR, int count)
+{
+    while (count > 0)
+    {
+        int run = std::min(count, lineLength - pos);
+        if (lineFormat == LineFormat::Packed12)
+        {
+            packFrames(quantL, quantR, packedBuffer.data() + static_cast<size_t>(pos) * 3, run);
+            quantL += run;
+            quantR += run;
+        }
+        else
+        {
+            std::copy(inL, inL + run, bufferL.begin() + pos);
+            std::copy(inR, inR + run, bufferR.begin() + pos);
+            inL += run;
+            inR += run;
+        }
+        count -= run;
+        pos = 0;
+    }
+}
+
+//------------------------------------------------------------------------
+int DelayBuffer::linePages(int frames) const
+{
+    int pages = (frames + LINE_PAGE_FRAMES - 1) / LINE_PAGE_FRAMES;
+    return std::min(pages * LINE_PAGE_FRAMES, maxSamples);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::growLine(int frames)
+{
+    int target = linePages(frames);
+    if (target <= lineLength)
+        return;
+    
+    // Offline and tools: commit on this thread and grow at once. If the OS
+    // refuses, the ring stays and the next block tries again.
+    if (!deferLineCommit)
+    {
+        growLineNow(target);
+        return;
+    }
+    
+    // Ask once; writeLine() grows the ring when the pages are ready
+    if (target > ringTarget)
+    {
+        ringTarget = target;
+        requestLine(target);
+    }
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::growLineNow(int frames)
+{
+    int target = linePages(frames);
+    if (target <= lineLength)
+        return true;
+    
+    ringTarget = std::max(ringTarget, target);
+    requestLine(target);
+    serviceLine();
+    pollLine();
+    if (lineUsableFrames < target)
+        return false;
+    
+    extendRing(target);
+    return true;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::extendRing(int frames)
+{
+    // The oldest frames [writePos, lineLength) move to the end of the
+    // longer ring. Right after a wrap nothing moves: the write carries on
+    // past the old end instead.
+    if (writePos == 0)
+        writePos = lineLength;
+    
+    size_t frameBytes = (lineFormat == LineFormat::Packed12) ? 3 : sizeof(float);
+    size_t tailBytes = static_cast<size_t>(lineLength - writePos) * frameBytes;
+    size_t shiftBytes = static_cast<size_t>(frames - lineLength) * frameBytes;
+    size_t splitBytes = static_cast<size_t>(writePos) * frameBytes;
+    if (tailBytes > 0)
+    {
+        VirtualBlock* blocks[2] = { &lineMemoryL, &lineMemoryR };
+        int numBlocks = (lineFormat == LineFormat::Packed12) ? 1 : 2;
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            uint8_t* base = blocks[i]->data();
+            std::memmove(base + splitBytes + shiftBytes, base + splitBytes, tailBytes);
+        }
+    }
+    
+    // The frames in between are older than validFrames, so they read as
+    // silence, which is the same in both channels
+    if (monoFrames >= lineLength)
+        monoFrames = frames;
+    
+    lineLength = frames;
+    ringTarget = std::max(ringTarget, frames);
+    updateLineSpans();
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::requestLine(int frames)
+{
+    // Pages past 'frames' are not used again until this request is answered
+    ++lineRequestSeq;
+    lineUsableFrames = std::min(lineUsableFrames, frames);
+    captureUsableFrames = captureEnabled ? std::min(captureUsableFrames, frames) : 0;
+    uint32_t field = static_cast<uint32_t>(frames) | (captureEnabled ? LINE_CAPTURE_FLAG : 0);
+    lineRequest.store((static_cast<uint64_t>(lineRequestSeq) << 32) | field, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::pollLine()
+{
+    uint64_t ready = lineReady.load(std::memory_order_acquire);
+    if (static_cast<uint32_t>(ready >> 32) == lineRequestSeq)
+    {
+        lineUsableFrames = static_cast<int>(ready & ~LINE_CAPTURE_FLAG & 0xFFFFFFFFu);
+        captureUsableFrames = (ready & LINE_CAPTURE_FLAG) ? lineUsableFrames : 0;
+    }
+}
+
+//------------------------------------------------------------------------
+// Commit and touch, or decommit, a block to hold exactly 'bytes'. False if
+// the OS is out of memory.
+static bool fitPages(VirtualBlock& block, size_t bytes)
+{
+    size_t had = block.getCommittedBytes();
+    if (bytes <= had)
+    {
+        block.decommit(bytes);
+        return true;
+    }
+    if (!block.commit(bytes))
+        return false;
+    
+    // Touch the new pages so the audio thread never faults on them
+    std::memset(block.data() + had, 0, block.getCommittedBytes() - had);
+    return true;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::serviceLine()
+{
+    bool packed = (lineFormat == LineFormat::Packed12);
+    
+    // The line a restore swapped out
+    int spent = kStageSpent;
+    if (stageState.compare_exchange_strong(spent, kStageBusy, std::memory_order_acquire))
+    {
+        stagedMemoryL.decommit(0);
+        stagedMemoryR.decommit(0);
+        stageState.store(kStageEmpty, std::memory_order_release);
+    }
+    
+    uint64_t request = lineRequest.load(std::memory_order_acquire);
+    if (request == lineReady.load(std::memory_order_relaxed))
+        return;
+    
+    // The audio thread stopped using pages past the request before it
+    // posted it, so a shorter line can hand them back. Out of memory, the
+    // request stays open and the next call retries.
+    uint32_t field = static_cast<uint32_t>(request & 0xFFFFFFFFu);
+    size_t frameBytes = packed ? 3 : sizeof(float);
+    size_t bytes = static_cast<size_t>(field & ~LINE_CAPTURE_FLAG) * frameBytes;
+    if (!fitPages(lineMemoryL, bytes) || (!packed && !fitPages(lineMemoryR, bytes)))
+        return;
+    
+    // Capture slots follow the line while capture is on. A finished copy
+    // that no longer fits is dropped first, unless readCapture() holds it.
+    size_t slotBytes = (field & LINE_CAPTURE_FLAG) ? bytes : 0;
+    for (CaptureSlot& slot : captureSlots)
+    {
+        if (slot.memoryL.commitSize(slotBytes) < slot.memoryL.getCommittedBytes())
+        {
+            int full = kSlotFull;
+            if (!slot.state.compare_exchange_strong(full, kSlotEmpty) && full != kSlotEmpty)
+                continue;
+        }
+        if (!fitPages(slot.memoryL, slotBytes) || (!packed && !fitPages(slot.memoryR, slotBytes)))
+            return;
+    }
+    lineReady.store(request, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::growLineFor(int delayMs)
+{
+    if (lineLength <= 0)
+        return;
+    int delaySamples = std::max(1, std::min(msToSamples(delayMs), maxSamples - 1));
+    growLineNow(delaySamples + 1);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::shrinkLine()
+{
+    // The ring starts over empty at one page, which is always committed.
+    // A copy under way would read frames that are gone.
+    invalidateCapture();
+    lineLength = std::min(LINE_PAGE_FRAMES, maxSamples);
+    ringTarget = lineLength;
+    validFrames = 0;
+    writePos = 0;
+    updateLineSpans();
+    
+    // Give back the pages past it: at once offline, by the worker otherwise
+    requestLine(lineLength);
+    if (!deferLineCommit)
+    {
+        serviceLine();
+        pollLine();
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::updateLineSpans()
+{
+    size_t frames = static_cast<size_t>(lineLength);
+    if (lineFormat == LineFormat::Packed12)
+    {
+        bufferL = ArenaSpan<float>();
+        bufferR = ArenaSpan<float>();
+        packedBuffer = ArenaSpan<uint8_t>(lineMemoryL.data(), frames * 3);
+    }
+    else
+    {
+        bufferL = ArenaSpan<float>(reinterpret_cast<float*>(lineMemoryL.data()), frames);
+        bufferR = ArenaSpan<float>(reinterpret_cast<float*>(lineMemoryR.data()), frames);
+        packedBuffer = ArenaSpan<uint8_t>();
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::setBitDepth(int bits)
+{
+    bitDepth = std::max(MIN_BIT_DEPTH, std::min(bits, MAX_BIT_DEPTH));
+    quantizeLevels = static_cast<float>(1 << bitDepth);
+    invQuantizeLevels = 1.0f / quantizeLevels;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::setInternalRate(int rateIndex)
+{
+    rateIndex = std::max(0, std::min(rateIndex, NUM_INTERNAL_RATES - 1));
+    if (rateIndex == internalRateIndex)
+        return;
+    
+    internalRateIndex = rateIndex;
+    internalRate = INTERNAL_RATES[rateIndex];
+    if (lineLength <= 0)
+        return;  // prepare() applies it
+    
+    // The line is forgotten, not zeroed; the pages it no longer needs are
+    // decommitted by whoever services the line
+    applyInternalRate();
+    shrinkLine();
+    reset();
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::applyInternalRate()
+{
+    internalRate = INTERNAL_RATES[internalRateIndex];
+    maxSamples = static_cast<int>(preparedDelayMs * internalRate / 1000.0);
+    
+    downsamplerL.setRates(hostSampleRate, internalRate);
+    downsamplerR.setRates(hostSampleRate, internalRate);
+    upsamplerL.setRates(internalRate, hostSampleRate);
+    upsamplerR.setRates(internalRate, hostSampleRate);
+    applyQuality();
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::applyQuality()
+{
+    quality = requestedQuality;
+    const DspTableSet& set = *tables[internalRateIndex][static_cast<int>(quality)];
+    
+    // Anti-aliasing before downsampling and reconstruction after
+    // upsampling (at HOST rate), 10 kHz at 24 kHz internal
+    antiAliasL.setCoefficients(set.antiAlias, OnePoleFilter::Type::LowPass);
+    antiAliasR.setCoefficients(set.antiAlias, OnePoleFilter::Type::LowPass);
+    reconstructL.setCoefficients(set.reconstruct, OnePoleFilter::Type::LowPass);
+    reconstructR.setCoefficients(set.reconstruct, OnePoleFilter::Type::LowPass);
+    
+    // Character filters (at INTERNAL rate): 80 Hz high-pass, 9 kHz low-pass
+    highPassL.setCoefficients(set.highPass, OnePoleFilter::Type::HighPass);
+    highPassR.setCoefficients(set.highPass, OnePoleFilter::Type::HighPass);
+    lowPassL.setCoefficients(set.lowPass, OnePoleFilter::Type::LowPass);
+    lowPassR.setCoefficients(set.lowPass, OnePoleFilter::Type::LowPass);
+    
+    downsamplerL.setKernel(&set.downsampler);
+    downsamplerR.setKernel(&set.downsampler);
+    upsamplerL.setKernel(&set.upsampler);
+    upsamplerR.setKernel(&set.upsampler);
+    
+    // Filter memory is shared between precisions and the resamplers keep
+    // their cubic history in every tier, so nothing needs to be reset
+    auto mode = (quality == Quality::High) ? LinearResampler::Interpolation::Cubic
+                                           : LinearResampler::Interpolation::Linear;
+    downsamplerL.setInterpolation(mode);
+    downsamplerR.setInterpolation(mode);
+    upsamplerL.setInterpolation(mode);
+    upsamplerR.setInterpolation(mode);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::buildTables(DspTableSet& set, double hostRate, double internalRate, int tier)
+{
+    // Only the high tier interpolates with the cubic weights
+    bool cubic = (tier == static_cast<int>(Quality::High));
+    LinearResampler::buildKernel(set.downsampler, hostRate, internalRate, cubic);
+    LinearResampler::buildKernel(set.upsampler, internalRate, hostRate, cubic);
     
-    // Read delayed output
-    float delayedL = bufferL[readPos];
-    float delayedR = bufferR[readPos];
+    // Keep the band limit below the internal Nyquist frequency; higher
+    // rates open up the anti-aliasing but keep the 9 kHz voicing
+    double scale = internalRate / INTERNAL_RATES[DEFAULT_INTERNAL_RATE];
+    double antiAliasFreq = ANTI_ALIAS_FREQ * scale;
+    double lowPassFreq = LOW_PASS_FREQ * std::min(1.0, scale);
+    
+    set.antiAlias = OnePoleFilter::computeCoefficients(hostRate, antiAliasFreq);
+    set.reconstruct = OnePoleFilter::computeCoefficients(hostRate, antiAliasFreq);
+    set.highPass = OnePoleFilter::computeCoefficients(internalRate, HIGH_PASS_FREQ);
+    set.lowPass = OnePoleFilter::computeCoefficients(internalRate, lowPassFreq);
+}
+
+//------------------------------------------------------------------------
+template <DelayBuffer::Quality Q>
+void DelayBuffer::processCharacter(float* left, float* right, int count)
+{
+    for (int i = 0; i < count; ++i)
+        processInternalSample<Q>(left[i], right[i], left[i], right[i], tempDownL[i], tempDownR[i]);
+}
+
+//------------------------------------------------------------------------
+template <DelayBuffer::Quality Q>
+void DelayBuffer::processCharacterMono(float* left, float* right, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        // Crosstalk between identical channels, written exactly as in
+        // processInternalSample so the result is the same
+        float delayed = left[i];
+        delayed = delayed + CROSSTALK_AMOUNT * delayed;
+        
+        if (Q == Quality::High)
+            delayed = lowPassL.processPrecise(highPassL.processPrecise(delayed));
+        else
+            delayed = lowPassL.process(highPassL.process(delayed));
+        
+        ditherSample<Q>(delayed, delayed, left[i], right[i], tempDownL[i], tempDownR[i]);
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::quantizeBlock(float* left, float* right, int count)
+{
+    quantizeBlockToLevels(left, tempDownL.data(), count, quantizeLevels, invQuantizeLevels);
+    quantizeBlockToLevels(right, tempDownR.data(), count, quantizeLevels, invQuantizeLevels);
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::channelsShareState(int delaySamples) const
+{
+    return monoFrames >= delaySamples
+        && antiAliasL.hasSameState(antiAliasR)
+        && downsamplerL.hasSameState(downsamplerR)
+        && highPassL.hasSameState(highPassR)
+        && lowPassL.hasSameState(lowPassR);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::trackMonoFrames(int count, bool mono)
+{
+    // Stereo input that happens to be identical also counts, so the fast
+    // path resumes once the channels have converged
+    int same = 0;
+    if (mono)
+    {
+        same = count;
+    }
+    else
+    {
+        while (same < count
+               && std::memcmp(&tempDownL[count - 1 - same], &tempDownR[count - 1 - same], sizeof(float)) == 0)
+            ++same;
+    }
+    monoFrames = (same == count) ? std::min(monoFrames + count, lineLength) : same;
+}
+
+//------------------------------------------------------------------------
+template <DelayBuffer::Quality Q>
+void DelayBuffer::processInternalSample(float inputL, float inputR,
+                                        float& ditheredL, float& ditheredR,
+                                        float& noiseL, float& noiseR)
+{
+    float delayedL = inputL;
+    float delayedR = inputR;
     
     // Apply channel crosstalk (authentic 80s analog bleed between L/R)
     // Small amount of each channel bleeds into the other
@@ -166,50 +939,83 @@ void DelayBuffer::processInternalSample(float inputL, float inputR,
     delayedL = crosstalkedL;
     delayedR = crosstalkedR;
     
-    // Apply character filters (at internal 24 kHz rate)
-    // High-pass (80 Hz) - removes low rumble
-    delayedL = highPassL.process(delayedL);
-    delayedR = highPassR.process(delayedR);
-    
-    // Low-pass (9 kHz) - warm high-end rolloff
-    delayedL = lowPassL.process(delayedL);
-    delayedR = lowPassR.process(delayedR);
+    // Apply character filters (at internal rate)
+    // The 80 Hz pole sits close to 1 at these rates, where double precision helps
+    if (Q == Quality::High)
+    {
+        // High-pass (80 Hz) - removes low rumble
+        delayedL = highPassL.processPrecise(delayedL);
+        delayedR = highPassR.processPrecise(delayedR);
+        
+        // Low-pass (9 kHz) - warm high-end rolloff
+        delayedL = lowPassL.processPrecise(delayedL);
+        delayedR = lowPassR.processPrecise(delayedR);
+    }
+    else
+    {
+        // High-pass (80 Hz) - removes low rumble
+        delayedL = highPassL.process(delayedL);
+        delayedR = highPassR.process(delayedR);
+        
+        // Low-pass (9 kHz) - warm high-end rolloff
+        delayedL = lowPassL.process(delayedL);
+        delayedR = lowPassR.process(delayedR);
+    }
     
-    // 12-bit quantization with light dither
+    ditherSample<Q>(delayedL, delayedR, ditheredL, ditheredR, noiseL, noiseR);
+}
+
+//------------------------------------------------------------------------
+template <DelayBuffer::Quality Q>
+void DelayBuffer::ditherSample(float inputL, float inputR,
+                               float& ditheredL, float& ditheredR,
+                               float& noiseL, float& noiseR)
+{
+    // Light dither ahead of quantization to bitDepth bits (12 by default)
     // Dither reduces harsh quantization artifacts for smoother sound
-    constexpr float BIT_DEPTH_LEVELS = 4096.0f;  // 2^12
-    constexpr float DITHER_AMPLITUDE = 0.5f / BIT_DEPTH_LEVELS;  // Very light: 0.5 LSB
-    
-    // Add TPDF dither (triangular probability density function)
-    // Two uniform randoms summed = triangular distribution
-    float ditherL = (ditherDist(rng) + ditherDist(rng)) * DITHER_AMPLITUDE;
-    float ditherR = (ditherDist(rng) + ditherDist(rng)) * DITHER_AMPLITUDE;
-    
-    delayedL = std::floor((delayedL + ditherL) * BIT_DEPTH_LEVELS + 0.5f) / BIT_DEPTH_LEVELS;
-    delayedR = std::floor((delayedR + ditherR) * BIT_DEPTH_LEVELS + 0.5f) / BIT_DEPTH_LEVELS;
+    const float ditherAmplitude = 0.5f * invQuantizeLevels;  // Very light: 0.5 LSB
     
     // Fixed noise floor at -80 dBFS (simulates analog electronics/ADC noise)
     // -80 dBFS = 10^(-80/20) = 0.0001 peak amplitude
     constexpr float NOISE_FLOOR_AMPLITUDE = 0.0001f;
     
-    float noiseL = ditherDist(rng) * NOISE_FLOOR_AMPLITUDE;
-    float noiseR = ditherDist(rng) * NOISE_FLOOR_AMPLITUDE;
-    
-    outputL = delayedL + noiseL;
-    outputR = delayedR + noiseR;
+    float ditherL, ditherR;
+    if (Q == Quality::Eco)
+    {
+        // Rectangular dither; the noise floor reuses the other channel's
+        // value. The stream still advances by NOISE_DRAWS_PER_SAMPLE so
+        // switching tiers keeps it on the same timeline.
+        float a = noise.next();
+        float b = noise.next();
+        noise.skip(NOISE_DRAWS_PER_SAMPLE - 2);
+        ditherL = a * ditherAmplitude;
+        ditherR = b * ditherAmplitude;
+        noiseL = b * NOISE_FLOOR_AMPLITUDE;
+        noiseR = a * NOISE_FLOOR_AMPLITUDE;
+    }
+    else
+    {
+        // Add TPDF dither (triangular probability density function)
+        // Two uniform randoms summed = triangular distribution
+        ditherL = (noise.next() + noise.next()) * ditherAmplitude;
+        ditherR = (noise.next() + noise.next()) * ditherAmplitude;
+        noiseL = noise.next() * NOISE_FLOOR_AMPLITUDE;
+        noiseR = noise.next() * NOISE_FLOOR_AMPLITUDE;
+    }
     
-    // Advance write position
-    writePos++;
-    if (writePos >= maxSamples)
-        writePos = 0;
+    ditheredL = inputL + ditherL;
+    ditheredR = inputR + ditherR;
 }
 
 //------------------------------------------------------------------------
 void DelayBuffer::reset()
 {
-    std::fill(bufferL.begin(), bufferL.end(), 0.0f);
-    std::fill(bufferR.begin(), bufferR.end(), 0.0f);
+    // Forgetting the history clears the line: frames past validFrames read
+    // as silence, so no line memory is touched
     writePos = 0;
+    validFrames = 0;
+    monoFrames = lineLength;
+    invalidateCapture();
     
     // Reset all filter states
     antiAliasL.reset();
@@ -226,13 +1032,516 @@ void DelayBuffer::reset()
     downsamplerR.reset();
     upsamplerL.reset();
     upsamplerR.reset();
+    upsampleCarry = 0;
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::isPreparedFor(double sampleRate, int maxDelayMs) const
+{
+    return lineLength > 0 && sampleRate == hostSampleRate && maxDelayMs == preparedDelayMs
+        && requestedLineFormat == lineFormat;
+}
+
+//------------------------------------------------------------------------
+size_t DelayBuffer::getLineBytes() const
+{
+    return lineMemoryL.getCommittedBytes() + lineMemoryR.getCommittedBytes();
+}
+
+//------------------------------------------------------------------------
+size_t DelayBuffer::getFootprintBytes() const
+{
+    size_t recallBytes = stagedMemoryL.getCommittedBytes() + stagedMemoryR.getCommittedBytes();
+    for (const CaptureSlot& slot : captureSlots)
+        recallBytes += slot.memoryL.getCommittedBytes() + slot.memoryR.getCommittedBytes();
+    return sizeof(*this) + arena.getBytes() + getLineBytes() + recallBytes;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::captureEngineState(DelayEngineState& state) const
+{
+    state.hostSampleRate = hostSampleRate;
+    state.internalSampleRate = internalRate;
+    
+    const OnePoleFilter* filters[DelayLineSnapshot::kNumFilters] = {
+        &antiAliasL, &antiAliasR, &reconstructL, &reconstructR,
+        &highPassL, &highPassR, &lowPassL, &lowPassR
+    };
+    for (int i = 0; i < DelayLineSnapshot::kNumFilters; ++i)
+        filters[i]->getState(state.filterZ1[i], state.filterX1[i]);
+    
+    const LinearResampler* resamplers[DelayLineSnapshot::kNumResamplers] = {
+        &downsamplerL, &downsamplerR, &upsamplerL, &upsamplerR
+    };
+    for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+    {
+        resamplers[i]->getState(state.resamplerPhase[i], state.resamplerLast[i]);
+        resamplers[i]->getHistory(state.resamplerPrev1[i], state.resamplerPrev2[i]);
+    }
+    
+    state.carryCount = upsampleCarry;
+    for (int i = 0; i < upsampleCarry; ++i)
+    {
+        state.carryL[i] = tempDelayedL[i];
+        state.carryR[i] = tempDelayedR[i];
+    }
+    state.noisePosition = noise.getPosition();
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::applyEngineState(const DelayEngineState& state)
+{
+    // Character filters run at the internal rate and always apply
+    OnePoleFilter* filters[DelayLineSnapshot::kNumFilters] = {
+        &antiAliasL, &antiAliasR, &reconstructL, &reconstructR,
+        &highPassL, &highPassR, &lowPassL, &lowPassR
+    };
+    bool sameHostRate = state.hostSampleRate == hostSampleRate;
+    int firstFilter = sameHostRate ? 0 : DelayLineSnapshot::kHighPassL;
+    for (int i = firstFilter; i < DelayLineSnapshot::kNumFilters; ++i)
+        filters[i]->setState(state.filterZ1[i], state.filterX1[i]);
+    
+    if (sameHostRate)
+    {
+        LinearResampler* resamplers[DelayLineSnapshot::kNumResamplers] = {
+            &downsamplerL, &downsamplerR, &upsamplerL, &upsamplerR
+        };
+        for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+        {
+            resamplers[i]->setState(state.resamplerPhase[i], state.resamplerLast[i]);
+            resamplers[i]->setHistory(state.resamplerPrev1[i], state.resamplerPrev2[i]);
+        }
+        
+        upsampleCarry = std::max(0, std::min(state.carryCount, static_cast<int>(DelayLineSnapshot::kMaxCarry)));
+        for (int i = 0; i < upsampleCarry; ++i)
+        {
+            tempDelayedL[i] = state.carryL[i];
+            tempDelayedR[i] = state.carryR[i];
+        }
+    }
+    
+    noise.setPosition(state.noisePosition);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::copyLineOut(uint8_t* outL, uint8_t* outR, int length, int valid,
+                              int64_t written, int first, int count) const
+{
+    bool packed = (lineFormat == LineFormat::Packed12);
+    size_t frameBytes = packed ? 3 : sizeof(float);
+    
+    // Forgotten frames are silence; frame 0 packs to three zero bytes
+    int silent = std::min(count, std::max(0, length - valid - first));
+    if (silent > 0)
+    {
+        std::memset(outL + static_cast<size_t>(first) * frameBytes, 0, silent * frameBytes);
+        if (!packed)
+            std::memset(outR + static_cast<size_t>(first) * frameBytes, 0, silent * frameBytes);
+        first += silent;
+        count -= silent;
+    }
+    if (count <= 0)
+        return;
+    
+    // Frame 'first' is now (length - 1 - first + written) frames old
+    int64_t age = static_cast<int64_t>(length - 1 - first) + written;
+    int pos = static_cast<int>(((writePos - 1 - age) % lineLength + lineLength) % lineLength);
+    while (count > 0)
+    {
+        int run = std::min(count, lineLength - pos);
+        size_t src = static_cast<size_t>(pos) * frameBytes;
+        size_t dst = static_cast<size_t>(first) * frameBytes;
+        if (packed)
+        {
+            std::memcpy(outL + dst, packedBuffer.data() + src, run * frameBytes);
+        }
+        else
+        {
+            std::memcpy(outL + dst, reinterpret_cast<const uint8_t*>(bufferL.data()) + src, run * frameBytes);
+            std::memcpy(outR + dst, reinterpret_cast<const uint8_t*>(bufferR.data()) + src, run * frameBytes);
+        }
+        first += run;
+        count -= run;
+        pos = 0;
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::captureSnapshot(DelayLineSnapshot& snapshot) const
+{
+    captureEngineState(snapshot);
+    
+    // The lineLength newest frames, oldest first
+    snapshot.packed = (lineFormat == LineFormat::Packed12);
+    if (snapshot.packed)
+    {
+        snapshot.packedLine.resize(static_cast<size_t>(lineLength) * 3);
+        copyLineOut(snapshot.packedLine.data(), nullptr, lineLength, validFrames, 0, 0, lineLength);
+        snapshot.lineL.clear();
+        snapshot.lineR.clear();
+    }
+    else
+    {
+        snapshot.lineL.resize(lineLength);
+        snapshot.lineR.resize(lineLength);
+        copyLineOut(reinterpret_cast<uint8_t*>(snapshot.lineL.data()),
+                    reinterpret_cast<uint8_t*>(snapshot.lineR.data()),
+                    lineLength, validFrames, 0, 0, lineLength);
+        snapshot.packedLine.clear();
+    }
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::restoreSnapshot(const DelayLineSnapshot& snapshot)
+{
+    if (!stageSnapshot(snapshot))
+        return false;
+    
+    // Answer any page request here, so the swap is not held up
+    serviceLine();
+    pollLine();
+    return applyStagedSnapshot(snapshot);
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::stageSnapshot(const DelayLineSnapshot& snapshot)
+{
+    if (!prepared || (!snapshot.packed && snapshot.lineL.size() != snapshot.lineR.size()))
+        return false;
+    
+    // The line only makes sense at the rate it was recorded at
+    const double* rate = std::find(INTERNAL_RATES, INTERNAL_RATES + NUM_INTERNAL_RATES, snapshot.internalSampleRate);
+    if (rate == INTERNAL_RATES + NUM_INTERNAL_RATES)
+        return false;
+    
+    // A ring of whole pages for the snapshot's frames, within the maximum
+    // delay at its rate; a longer snapshot keeps its newest frames
+    int rateIndex = static_cast<int>(rate - INTERNAL_RATES);
+    int rateMax = static_cast<int>(preparedDelayMs * INTERNAL_RATES[rateIndex] / 1000.0);
+    int frames = snapshot.getNumFrames();
+    int pages = std::max(1, (frames + LINE_PAGE_FRAMES - 1) / LINE_PAGE_FRAMES);
+    int length = std::min(pages * LINE_PAGE_FRAMES, rateMax);
+    int count = std::min(length, frames);
+    int offset = frames - count;
+    
+    // Take the spare pages; the audio thread only holds them for a swap
+    for (;;)
+    {
+        int state = stageState.load(std::memory_order_acquire);
+        if (state != kStageBusy && stageState.compare_exchange_weak(state, kStageBusy, std::memory_order_acquire))
+            break;
+        std::this_thread::yield();
+    }
+    
+    bool packed = (lineFormat == LineFormat::Packed12);
+    size_t frameBytes = packed ? 3 : sizeof(float);
+    size_t bytes = static_cast<size_t>(length) * frameBytes;
+    if (!fitPages(stagedMemoryL, bytes) || (!packed && !fitPages(stagedMemoryR, bytes)))
+    {
+        stageState.store(kStageEmpty, std::memory_order_release);
+        return false;
+    }
+    
+    // The newest frames end at the end of the ring, for writePos = 0.
+    // Frames before them are never read: validFrames marks them silent.
+    constexpr int CHUNK = 256;
+    int16_t quantL[CHUNK], quantR[CHUNK];
+    float floatL[CHUNK], floatR[CHUNK];
+    int dst = length - count;
+    for (int done = 0; done < count; done += CHUNK)
+    {
+        int run = std::min(CHUNK, count - done);
+        int src = offset + done;
+        size_t at = static_cast<size_t>(dst + done) * frameBytes;
+        if (snapshot.packed && packed)
+        {
+            std::memcpy(stagedMemoryL.data() + at, snapshot.packedLine.data() + static_cast<size_t>(src) * 3, run * frameBytes);
+            continue;
+        }
+        
+        const float* inL = floatL;
+        const float* inR = floatR;
+        if (snapshot.packed)
+        {
+            unpackFrames(snapshot.packedLine.data() + static_cast<size_t>(src) * 3, quantL, quantR, run);
+            lineToFloat(quantL, floatL, run);
+            lineToFloat(quantR, floatR, run);
+        }
+        else
+        {
+            inL = snapshot.lineL.data() + src;
+            inR = snapshot.lineR.data() + src;
+        }
+        
+        if (packed)
+        {
+            quantizeToLine(inL, quantL, run);
+            quantizeToLine(inR, quantR, run);
+            packFrames(quantL, quantR, stagedMemoryL.data() + at, run);
+        }
+        else
+        {
+            std::memcpy(stagedMemoryL.data() + at, inL, run * frameBytes);
+            std::memcpy(stagedMemoryR.data() + at, inR, run * frameBytes);
+        }
+    }
+    
+    stagedLength = length;
+    stagedFrames = count;
+    stagedRateIndex = rateIndex;
+    stageState.store(kStageReady, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::applyStagedSnapshot(const DelayLineSnapshot& snapshot)
+{
+    if (lineLength <= 0 || stageState.load(std::memory_order_relaxed) != kStageReady)
+        return false;
+    
+    // serviceLine() is done with the line's blocks once it has answered
+    // the latest request, and does not touch them again until the next one
+    if (lineReady.load(std::memory_order_acquire) != lineRequest.load(std::memory_order_relaxed))
+        return false;
+    int expected = kStageReady;
+    if (!stageState.compare_exchange_strong(expected, kStageBusy, std::memory_order_acquire))
+        return false;
+    
+    lineMemoryL.swap(stagedMemoryL);
+    lineMemoryR.swap(stagedMemoryR);
+    if (stagedRateIndex != internalRateIndex)
+    {
+        internalRateIndex = stagedRateIndex;
+        applyInternalRate();
+    }
+    lineLength = stagedLength;
+    ringTarget = lineLength;
+    updateLineSpans();
+    
+    reset();
+    validFrames = stagedFrames;
+    monoFrames = 0;
+    applyEngineState(snapshot);
+    
+    // The staged pages were committed and touched; capture slots follow
+    // the new length through the usual request
+    lineUsableFrames = lineLength;
+    stageState.store(kStageSpent, std::memory_order_release);
+    requestLine(lineLength);
+    if (!deferLineCommit)
+    {
+        serviceLine();
+        pollLine();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::setLineCapture(bool enable)
+{
+    if (enable == captureEnabled)
+        return;
+    
+    captureEnabled = enable;
+    if (!enable)
+        invalidateCapture();
+    if (lineLength <= 0)
+        return;  // prepare() asks for the slots
+    
+    // Same pages as the line, including growth already asked for
+    requestLine(std::max(lineLength, ringTarget));
+    if (!deferLineCommit)
+    {
+        serviceLine();
+        pollLine();
+    }
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::invalidateCapture()
+{
+    if (captureSlot >= 0)
+        captureSlots[captureSlot].state.store(kSlotEmpty, std::memory_order_relaxed);
+    captureSlot = -1;
+    captureCurrent = false;
+    captureEpoch.fetch_add(1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::updateCapture(int maxFrames)
+{
+    // What the last block wrote; a copy has to keep that far ahead of the
+    // writes, from its first slice on
+    int64_t blockFrames = std::min<int64_t>(lineWritten - captureChecked, lineLength);
+    captureChecked = lineWritten;
+    if (!captureEnabled || lineLength <= 0)
+        return;
+    pollLine();
+    
+    if (captureSlot < 0)
+    {
+        // Start a copy when the last one is stale and the slots can hold it
+        double age = static_cast<double>(lineWritten - captureStart);
+        bool due = !captureCurrent || age >= CAPTURE_INTERVAL_SECONDS * internalRate;
+        if (!due || captureUsableFrames < lineLength)
+            return;
+        
+        // An Empty slot, else the older Full one; never the one being read
+        int first = captureSlots[0].serial <= captureSlots[1].serial ? 0 : 1;
+        for (int i = 0; i < NUM_CAPTURE_SLOTS && captureSlot < 0; ++i)
+        {
+            int index = (first + i) % NUM_CAPTURE_SLOTS;
+            int state = captureSlots[index].state.load(std::memory_order_relaxed);
+            if ((state == kSlotEmpty || state == kSlotFull)
+                && captureSlots[index].state.compare_exchange_strong(state, kSlotFilling, std::memory_order_acquire))
+                captureSlot = index;
+        }
+        if (captureSlot < 0)
+            return;
+        
+        CaptureSlot& slot = captureSlots[captureSlot];
+        captureEngineState(slot.engineState);
+        slot.frames = lineLength;
+        slot.epoch = captureEpoch.load(std::memory_order_relaxed);
+        captureLength = lineLength;
+        captureValid = validFrames;
+        captureDone = 0;
+        captureStart = lineWritten;
+    }
+    
+    // The oldest frame still to copy must not have been overwritten; a
+    // block longer than the ring can do that
+    int64_t written = lineWritten - captureStart;
+    int nextAge = captureLength - 1 - captureDone;
+    if (nextAge < captureValid && nextAge + written >= lineLength)
+    {
+        captureSlots[captureSlot].state.store(kSlotEmpty, std::memory_order_relaxed);
+        captureSlot = -1;
+        return;
+    }
+    
+    int budget = maxFrames + static_cast<int>(blockFrames);
+    int run = std::min(captureLength - captureDone, budget);
+    CaptureSlot& slot = captureSlots[captureSlot];
+    copyLineOut(slot.memoryL.data(), slot.memoryR.data(), captureLength, captureValid, written, captureDone, run);
+    captureDone += run;
+    
+    if (captureDone == captureLength)
+    {
+        slot.serial = ++captureSerial;
+        slot.state.store(kSlotFull, std::memory_order_release);
+        captureSlot = -1;
+        captureCurrent = true;
+    }
+}
+
+//------------------------------------------------------------------------
+bool DelayBuffer::readCapture(DelayLineSnapshot& snapshot)
+{
+    // Hold the newest current copy; the audio thread fills the other slot
+    uint32_t epoch = captureEpoch.load(std::memory_order_acquire);
+    int best = -1;
+    for (int i = 0; i < NUM_CAPTURE_SLOTS; ++i)
+    {
+        int full = kSlotFull;
+        if (!captureSlots[i].state.compare_exchange_strong(full, kSlotReading, std::memory_order_acquire))
+            continue;
+        if (captureSlots[i].epoch != epoch || (best >= 0 && captureSlots[best].serial > captureSlots[i].serial))
+        {
+            captureSlots[i].state.store(kSlotFull, std::memory_order_release);
+            continue;
+        }
+        if (best >= 0)
+            captureSlots[best].state.store(kSlotFull, std::memory_order_release);
+        best = i;
+    }
+    if (best < 0)
+        return false;
+    
+    const CaptureSlot& slot = captureSlots[best];
+    static_cast<DelayEngineState&>(snapshot) = slot.engineState;
+    snapshot.packed = (lineFormat == LineFormat::Packed12);
+    size_t frames = static_cast<size_t>(slot.frames);
+    if (snapshot.packed)
+    {
+        snapshot.packedLine.assign(slot.memoryL.data(), slot.memoryL.data() + frames * 3);
+        snapshot.lineL.clear();
+        snapshot.lineR.clear();
+    }
+    else
+    {
+        const float* left = reinterpret_cast<const float*>(slot.memoryL.data());
+        const float* right = reinterpret_cast<const float*>(slot.memoryR.data());
+        snapshot.lineL.assign(left, left + frames);
+        snapshot.lineR.assign(right, right + frames);
+        snapshot.packedLine.clear();
+    }
+    captureSlots[best].state.store(kSlotFull, std::memory_order_release);
+    return true;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::setNoiseSeed(uint64_t seed)
+{
+    noise.seed(seed);
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::setRenderPosition(int64_t hostSample)
+{
+    downsamplerL.seekDownsample(hostSample);
+    downsamplerR.seekDownsample(hostSample);
+    upsamplerL.seekUpsample(hostSample);
+    upsamplerR.seekUpsample(hostSample);
+    
+    // Internal samples produced vs. consumed at this point in a single pass
+    int64_t produced = downsamplerL.downsampledCount(hostSample);
+    int64_t consumed = upsamplerL.upsampleConsumed(hostSample);
+    upsampleCarry = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(produced - consumed, DelayLineSnapshot::kMaxCarry)));
+    std::fill(tempDelayedL.begin(), tempDelayedL.begin() + upsampleCarry, 0.0f);
+    std::fill(tempDelayedR.begin(), tempDelayedR.begin() + upsampleCarry, 0.0f);
+    
+    noise.setPosition(static_cast<uint64_t>(produced) * NOISE_DRAWS_PER_SAMPLE);
+}
+
+//------------------------------------------------------------------------
+int DelayBuffer::getPrerollSamples(int delayMs) const
+{
+    // The 80 Hz high-pass is by far the slowest memory in the chain. Wait
+    // for any initial difference to decay by 2^-64, which leaves it far
+    // below float resolution even for quiet signals.
+    constexpr double SETTLE_DECAY_BITS = 64.0;
+    double hpOmega = 2.0 * 3.14159265358979323846 * HIGH_PASS_FREQ / internalRate;
+    double settleInternal = SETTLE_DECAY_BITS * std::log(2.0) / hpOmega;
+    
+    int delaySamples = std::max(1, std::min(msToSamples(delayMs), maxSamples - 1));
+    double internalSamples = delaySamples + settleInternal;
+    
+    // Host-rate anti-alias/reconstruction filters settle within a few
+    // dozen samples; pad generously
+    constexpr int HOST_SETTLE_SAMPLES = 256;
+    return static_cast<int>(std::ceil(internalSamples * hostSampleRate / internalRate)) + HOST_SETTLE_SAMPLES;
+}
+
+//------------------------------------------------------------------------
+void DelayBuffer::preroll(const float* leftIn, const float* rightIn, int numSamples, int delayMs)
+{
+    constexpr int CHUNK = 256;
+    float discardL[CHUNK];
+    float discardR[CHUNK];
+    
+    for (int offset = 0; offset < numSamples; offset += CHUNK)
+    {
+        int count = std::min(CHUNK, numSamples - offset);
+        processStereo(leftIn + offset, discardL, rightIn + offset, discardR, count, delayMs);
+    }
 }
 
 //------------------------------------------------------------------------
 int DelayBuffer::msToSamples(int ms) const
 {
-    // Convert to samples at INTERNAL 24 kHz rate
-    return static_cast<int>(ms * INTERNAL_SAMPLE_RATE / 1000.0);
+    // Convert to samples at the internal rate
+    return static_cast<int>(ms * internalRate / 1000.0);
 }
 
 //------------------------------------------------------------------------
@@ -4,141 +4,528 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include <cstring>
 #include <cmath>
-#include <random>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include "stageprofiler.h"
+#include "dsparena.h"
+#include "dsptables.h"
 
 namespace Yonie {
 
 //------------------------------------------------------------------------
 // OnePoleFilter - Simple 1st-order (6 dB/oct) filter
+// process() runs in float; processPrecise() runs the same filter in double
+// for the high quality tier. Both share the memory, which is held in
+// double, so a filter can switch between them from one sample to the next.
 //------------------------------------------------------------------------
 class OnePoleFilter
 {
 public:
     enum class Type { LowPass, HighPass };
     
-    OnePoleFilter() : z1(0.0f), x1(0.0f), coefficient(0.0f), type(Type::LowPass) {}
+    OnePoleFilter() : z1(0.0), x1(0.0), coefficient(0.0f), coefficientPrecise(0.0), type(Type::LowPass) {}
     
-    // Set filter parameters
-    void setCoefficients(double sampleRate, double cutoffHz, Type filterType)
+    // Calculate coefficient for 1st-order filter
+    // Using: coefficient = exp(-2π * fc / fs)
+    static OnePoleCoefficients computeCoefficients(double sampleRate, double cutoffHz)
     {
-        type = filterType;
-        // Calculate coefficient for 1st-order filter
-        // Using: coefficient = exp(-2π * fc / fs)
         double omega = 2.0 * 3.14159265358979323846 * cutoffHz / sampleRate;
-        coefficient = static_cast<float>(std::exp(-omega));
+        OnePoleCoefficients result;
+        result.coefficientPrecise = std::exp(-omega);
+        result.coefficient = static_cast<float>(result.coefficientPrecise);
+        return result;
+    }
+    
+    // Set filter parameters (real-time safe)
+    void setCoefficients(const OnePoleCoefficients& coefficients, Type filterType)
+    {
+        type = filterType;
+        coefficient = coefficients.coefficient;
+        coefficientPrecise = coefficients.coefficientPrecise;
     }
     
     // Process a single sample
     float process(float input)
     {
+        float prevOutput = static_cast<float>(z1);
         float output;
         if (type == Type::LowPass)
         {
             // Low-pass: y[n] = (1-a) * x[n] + a * y[n-1]
-            output = (1.0f - coefficient) * input + coefficient * z1;
+            output = (1.0f - coefficient) * input + coefficient * prevOutput;
         }
         else
         {
             // High-pass: y[n] = a * (y[n-1] + x[n] - x[n-1])
-            output = coefficient * (z1 + input - x1);
+            output = coefficient * (prevOutput + input - static_cast<float>(x1));
         }
         z1 = output;
         x1 = input;
         return output;
     }
     
+    // Same filter in double precision
+    float processPrecise(float input)
+    {
+        double output;
+        if (type == Type::LowPass)
+            output = (1.0 - coefficientPrecise) * input + coefficientPrecise * z1;
+        else
+            output = coefficientPrecise * (z1 + input - x1);
+        z1 = output;
+        x1 = input;
+        return static_cast<float>(output);
+    }
+    
     // Reset filter state
     void reset()
     {
-        z1 = 0.0f;
-        x1 = 0.0f;
+        z1 = 0.0;
+        x1 = 0.0;
     }
     
+    // Access filter memory (for state snapshots)
+    void getState(float& outZ1, float& outX1) const
+    {
+        outZ1 = static_cast<float>(z1);
+        outX1 = static_cast<float>(x1);
+    }
+    void setState(float newZ1, float newX1) { z1 = newZ1; x1 = newX1; }
+    
+    // Bitwise comparison/copy of the memory with another filter, used to
+    // run identical channels through one filter
+    bool hasSameState(const OnePoleFilter& other) const
+    {
+        return std::memcmp(&z1, &other.z1, sizeof(z1)) == 0
+            && std::memcmp(&x1, &other.x1, sizeof(x1)) == 0;
+    }
+    void copyStateFrom(const OnePoleFilter& other) { z1 = other.z1; x1 = other.x1; }
+    
 private:
-    float z1;          // Previous output (y[n-1])
-    float x1;          // Previous input (x[n-1]) - used for high-pass
-    float coefficient; // Filter coefficient
-    Type type;         // Filter type
+    double z1;                 // Previous output (y[n-1])
+    double x1;                 // Previous input (x[n-1]) - used for high-pass
+    float coefficient;         // Filter coefficient
+    double coefficientPrecise; // Same, for processPrecise()
+    Type type;                 // Filter type
 };
 
 //------------------------------------------------------------------------
-// Simple linear interpolation resampler
+// Simple interpolating resampler (linear, or cubic for the high tier)
+// The rate ratio is kept as a reduced fraction inputStep/outputStep (e.g.
+// 147/80 for 44.1 kHz -> 24 kHz) and the phase is an integer count of
+// 1/outputStep input samples, so the sample grid after any number of
+// samples is exact and can be computed in closed form. Rates are rounded
+// to whole Hz, which covers every rate hosts actually use.
+//
+// Cubic mode is a causal 4-point Lagrange interpolator over the two
+// samples before the interpolated interval, so it sits on the same grid
+// as linear mode and the two can be swapped between blocks.
 //------------------------------------------------------------------------
 class LinearResampler
 {
 public:
-    LinearResampler() : phase(0.0), lastSample(0.0f) {}
+    enum class Interpolation { Linear, Cubic };
+    
+    // Ratios with up to this many phases get precomputed coefficient tables
+    static constexpr int64_t MAX_PHASE_TABLE = 4096;
+    
+    LinearResampler() : phase(0), inputStep(1), outputStep(1), invOutputStep(1.0f),
+                        lastSample(0.0f), prev1(0.0f), prev2(0.0f),
+                        interpolation(Interpolation::Linear),
+                        phaseTable(nullptr), cubicTable(nullptr) {}
+    
+    // Reduce the rate ratio to inputStep/outputStep
+    static void reduceRatio(double inputRate, double outputRate, int64_t& reducedIn, int64_t& reducedOut)
+    {
+        int64_t in = std::max<int64_t>(1, std::llround(inputRate));
+        int64_t out = std::max<int64_t>(1, std::llround(outputRate));
+        int64_t divisor = std::gcd(in, out);
+        reducedIn = in / divisor;
+        reducedOut = out / divisor;
+    }
+    
+    // Fill a kernel's tables for a ratio (allocates; see DspTableCache)
+    static void buildKernel(ResamplerKernel& kernel, double inputRate, double outputRate, bool withCubic)
+    {
+        reduceRatio(inputRate, outputRate, kernel.inputStep, kernel.outputStep);
+        kernel.phase.clear();
+        kernel.cubic.clear();
+        if (kernel.outputStep > MAX_PHASE_TABLE)
+            return;
+        
+        kernel.phase.resize(static_cast<size_t>(kernel.outputStep));
+        if (withCubic)
+            kernel.cubic.resize(static_cast<size_t>(kernel.outputStep) * 4);
+        for (int64_t p = 0; p < kernel.outputStep; ++p)
+        {
+            double t = static_cast<double>(p) / kernel.outputStep;
+            kernel.phase[static_cast<size_t>(p)] = static_cast<float>(t);
+            if (withCubic)
+                cubicWeights(t, &kernel.cubic[static_cast<size_t>(p) * 4]);
+        }
+    }
+    
+    void setRates(double inputRate, double outputRate)
+    {
+        reduceRatio(inputRate, outputRate, inputStep, outputStep);
+        invOutputStep = 1.0f / static_cast<float>(outputStep);
+        phaseTable = nullptr;
+        cubicTable = nullptr;
+    }
+    
+    // Use shared coefficient tables; the kernel must outlive their use.
+    // A kernel for another ratio is ignored. Real-time safe.
+    void setKernel(const ResamplerKernel* kernel)
+    {
+        bool usable = kernel && kernel->inputStep == inputStep && kernel->outputStep == outputStep;
+        phaseTable = (usable && !kernel->phase.empty()) ? kernel->phase.data() : nullptr;
+        cubicTable = (usable && !kernel->cubic.empty()) ? kernel->cubic.data() : nullptr;
+    }
+    
+    // Switching is click-free and allocation-free at any block boundary
+    void setInterpolation(Interpolation mode) { interpolation = mode; }
+    
+    // Reduced ratio input:output
+    int64_t getInputStep() const { return inputStep; }
+    int64_t getOutputStep() const { return outputStep; }
+    
+    // Exact number of samples downsample() produces for the next 'inputSamples'
+    int outputsFor(int inputSamples) const
+    {
+        return static_cast<int>(std::max<int64_t>(0, ceilDiv(inputSamples * outputStep - phase, inputStep)));
+    }
     
     void reset()
     {
-        phase = 0.0;
+        phase = 0;
         lastSample = 0.0f;
+        prev1 = 0.0f;
+        prev2 = 0.0f;
     }
     
     // Downsample from higher rate to lower rate
     // Returns number of output samples written
     int downsample(const float* input, int inputSamples,
-                   float* output, int maxOutputSamples,
-                   double inputRate, double outputRate)
+                   float* output, int maxOutputSamples)
+    {
+        return downsampleWith(input, inputSamples, output, maxOutputSamples, Passthrough());
+    }
+    
+    // Same, running every input through 'prefilter' first. The filtered
+    // sample stays in a register, so no host-rate temporary is needed.
+    int downsample(const float* input, int inputSamples,
+                   float* output, int maxOutputSamples, OnePoleFilter& prefilter)
+    {
+        return downsampleWith(input, inputSamples, output, maxOutputSamples, FilterStage{prefilter});
+    }
+    
+    // Upsample from lower rate to higher rate
+    // Returns number of input samples consumed; the caller keeps the rest
+    // and passes them again at the start of the next block
+    int upsample(const float* input, int inputSamples,
+                 float* output, int outputSamples)
+    {
+        return upsampleWith(input, inputSamples, output, outputSamples, Passthrough());
+    }
+    
+    // Same, running every output through 'postfilter' before it is stored
+    int upsample(const float* input, int inputSamples,
+                 float* output, int outputSamples, OnePoleFilter& postfilter)
+    {
+        return upsampleWith(input, inputSamples, output, outputSamples, FilterStage{postfilter});
+    }
+    
+    // Output samples a downsampler has produced after 'inputPosition' inputs
+    int64_t downsampledCount(int64_t inputPosition) const
+    {
+        return ceilDiv(inputPosition * outputStep, inputStep);
+    }
+    
+    // Input samples an upsampler has consumed after 'outputPosition' outputs
+    int64_t upsampleConsumed(int64_t outputPosition) const
+    {
+        return floorDiv(outputPosition * inputStep, outputStep);
+    }
+    
+    // Put the phase where a single pass from sample 0 would have it
+    void seekDownsample(int64_t inputPosition)
+    {
+        phase = downsampledCount(inputPosition) * inputStep - inputPosition * outputStep;
+    }
+    
+    void seekUpsample(int64_t outputPosition)
+    {
+        phase = outputPosition * inputStep - upsampleConsumed(outputPosition) * outputStep;
+    }
+    
+    // Access interpolation state (for state snapshots)
+    // Phase is exchanged as a fraction of an output step
+    void getState(double& outPhase, float& outLast) const
+    {
+        outPhase = static_cast<double>(phase) / static_cast<double>(outputStep);
+        outLast = lastSample;
+    }
+    void setState(double newPhase, float newLast)
+    {
+        phase = std::llround(newPhase * static_cast<double>(outputStep));
+        lastSample = newLast;
+    }
+    
+    // Older input history used by cubic mode (kept in every mode)
+    void getHistory(float& outPrev1, float& outPrev2) const { outPrev1 = prev1; outPrev2 = prev2; }
+    void setHistory(float newPrev1, float newPrev2) { prev1 = newPrev1; prev2 = newPrev2; }
+    
+    // Bitwise comparison/copy of the running state with a resampler of the
+    // same ratio and mode
+    bool hasSameState(const LinearResampler& other) const
+    {
+        const float mine[3] = { lastSample, prev1, prev2 };
+        const float theirs[3] = { other.lastSample, other.prev1, other.prev2 };
+        return phase == other.phase && std::memcmp(mine, theirs, sizeof(mine)) == 0;
+    }
+    void copyStateFrom(const LinearResampler& other)
+    {
+        phase = other.phase;
+        lastSample = other.lastSample;
+        prev1 = other.prev1;
+        prev2 = other.prev2;
+    }
+    
+private:
+    static int64_t floorDiv(int64_t a, int64_t b) { return a / b - ((a % b != 0) && ((a < 0) != (b < 0))); }
+    static int64_t ceilDiv(int64_t a, int64_t b) { return -floorDiv(-a, b); }
+    
+    // Lagrange weights for samples at -2, -1, 0, 1, evaluated at t in [0, 1)
+    static void cubicWeights(double t, float* w)
+    {
+        w[0] = static_cast<float>(-(t + 1.0) * t * (t - 1.0) / 6.0);
+        w[1] = static_cast<float>((t + 2.0) * t * (t - 1.0) / 2.0);
+        w[2] = static_cast<float>(-(t + 2.0) * (t + 1.0) * (t - 1.0) / 2.0);
+        w[3] = static_cast<float>((t + 2.0) * (t + 1.0) * t / 6.0);
+    }
+    
+    // Interpolate between lastSample and 'next' at 0 <= p < outputStep
+    template <bool Cubic>
+    float interpolate(int64_t p, float next) const
+    {
+        if (Cubic)
+        {
+            float computed[4];
+            const float* w = computed;
+            if (cubicTable)
+                w = &cubicTable[static_cast<size_t>(p) * 4];
+            else
+                cubicWeights(static_cast<double>(p) / outputStep, computed);
+            return w[0] * prev2 + w[1] * prev1 + w[2] * lastSample + w[3] * next;
+        }
+        
+        float t = phaseTable ? phaseTable[static_cast<size_t>(p)]
+                             : static_cast<float>(p) * invOutputStep;
+        return lastSample + t * (next - lastSample);
+    }
+    
+    void push(float sample)
+    {
+        prev2 = prev1;
+        prev1 = lastSample;
+        lastSample = sample;
+    }
+    
+    // Per-sample stages fused into the resampling loops
+    struct Passthrough
+    {
+        float operator()(float x) const { return x; }
+    };
+    struct FilterStage
+    {
+        OnePoleFilter& filter;
+        float operator()(float x) const { return filter.process(x); }
+    };
+    
+    template <typename Stage>
+    int downsampleWith(const float* input, int inputSamples,
+                       float* output, int maxOutputSamples, Stage stage)
+    {
+        return interpolation == Interpolation::Cubic
+            ? downsampleImpl<true>(input, inputSamples, output, maxOutputSamples, stage)
+            : downsampleImpl<false>(input, inputSamples, output, maxOutputSamples, stage);
+    }
+    
+    template <typename Stage>
+    int upsampleWith(const float* input, int inputSamples,
+                     float* output, int outputSamples, Stage stage)
+    {
+        return interpolation == Interpolation::Cubic
+            ? upsampleImpl<true>(input, inputSamples, output, outputSamples, stage)
+            : upsampleImpl<false>(input, inputSamples, output, outputSamples, stage);
+    }
+    
+    template <bool Cubic, typename Stage>
+    int downsampleImpl(const float* input, int inputSamples,
+                       float* output, int maxOutputSamples, Stage stage)
     {
-        double ratio = inputRate / outputRate;
         int outCount = 0;
         
-        for (int i = 0; i < inputSamples && outCount < maxOutputSamples; ++i)
+        // Every input must advance the phase, even once the output is full
+        for (int i = 0; i < inputSamples; ++i)
         {
-            float currentSample = input[i];
+            float currentSample = stage(input[i]);
             
-            while (phase < 1.0 && outCount < maxOutputSamples)
+            while (phase < outputStep && outCount < maxOutputSamples)
             {
-                // Linear interpolation
-                float t = static_cast<float>(phase);
-                output[outCount++] = lastSample + t * (currentSample - lastSample);
-                phase += ratio;
+                output[outCount++] = interpolate<Cubic>(phase, currentSample);
+                phase += inputStep;
             }
             
-            phase -= 1.0;
-            lastSample = currentSample;
+            phase -= outputStep;
+            push(currentSample);
         }
         
         return outCount;
     }
     
-    // Upsample from lower rate to higher rate
-    // Returns number of output samples written
-    int upsample(const float* input, int inputSamples,
-                 float* output, int outputSamples,
-                 double inputRate, double outputRate)
+    template <bool Cubic, typename Stage>
+    int upsampleImpl(const float* input, int inputSamples,
+                     float* output, int outputSamples, Stage stage)
     {
-        double ratio = inputRate / outputRate;
         int inIndex = 0;
         
         for (int i = 0; i < outputSamples; ++i)
         {
-            // Linear interpolation between samples
-            float t = static_cast<float>(phase);
+            // A starved upsampler holds lastSample, so clamping the phase is harmless
             float currentSample = (inIndex < inputSamples) ? input[inIndex] : lastSample;
-            output[i] = lastSample + t * (currentSample - lastSample);
+            output[i] = stage(interpolate<Cubic>(std::min(phase, outputStep - 1), currentSample));
             
-            phase += ratio;
-            while (phase >= 1.0 && inIndex < inputSamples)
+            phase += inputStep;
+            while (phase >= outputStep && inIndex < inputSamples)
             {
-                lastSample = input[inIndex++];
-                phase -= 1.0;
+                push(input[inIndex++]);
+                phase -= outputStep;
             }
         }
         
-        if (inIndex > 0 && inIndex <= inputSamples)
-            lastSample = input[inIndex - 1];
-            
-        return outputSamples;
+        return inIndex;
+    }
+    
+    int64_t phase;        // In units of 1/outputStep input samples
+    int64_t inputStep;    // Input rate / gcd
+    int64_t outputStep;   // Output rate / gcd
+    float invOutputStep;
+    float lastSample;     // Input sample at the start of the current interval
+    float prev1;          // The two inputs before lastSample (cubic mode)
+    float prev2;
+    Interpolation interpolation;
+    const float* phaseTable;       // p / outputStep for every phase, or null
+    const float* cubicTable;       // 4 Lagrange weights for every phase, or null
+};
+
+//------------------------------------------------------------------------
+// quantizeToLevels - Round to the nearest step of 1/levels
+// Same result as std::floor(x * levels + 0.5f) / levels for power-of-two
+// levels, but converts to integer by truncation and corrects negative
+// values with a compare: no libm call and no branch. Inputs beyond 2^24
+// steps are clamped, which also sends NaN to the lower bound.
+//------------------------------------------------------------------------
+inline float quantizeToLevels(float x, float levels, float invLevels)
+{
+    constexpr float LIMIT = 16777216.0f;  // 2^24
+    float scaled = x * levels + 0.5f;
+    scaled = std::min(LIMIT, std::max(-LIMIT, scaled));
+    int32_t truncated = static_cast<int32_t>(scaled);
+    int32_t floored = truncated - (scaled < static_cast<float>(truncated) ? 1 : 0);
+    return static_cast<float>(floored) * invLevels;
+}
+
+// samples[i] = quantizeToLevels(samples[i]) + noiseFloor[i], four at a
+// time with SSE2 where available; bit-identical to the scalar form
+void quantizeBlockToLevels(float* samples, const float* noiseFloor, int count,
+                           float levels, float invLevels);
+
+//------------------------------------------------------------------------
+// NoiseGenerator - Counter-based uniform noise for dither and noise floor
+// Each value is a hash of (seed, position), so the stream can be jumped
+// to any position in O(1) and two instances with the same seed agree.
+//------------------------------------------------------------------------
+class NoiseGenerator
+{
+public:
+    NoiseGenerator() : key(0), counter(0) {}
+    
+    void seed(uint64_t newSeed) { key = newSeed; }
+    void setPosition(uint64_t position) { counter = position; }
+    uint64_t getPosition() const { return counter; }
+    
+    // Jump over values without computing them
+    void skip(uint64_t count) { counter += count; }
+    
+    // Uniform in [-1, 1)
+    float next()
+    {
+        // SplitMix64 finalizer over a Weyl sequence
+        uint64_t z = key + (++counter) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        return static_cast<float>(z >> 40) * (2.0f / 16777216.0f) - 1.0f;
     }
     
 private:
-    double phase;
-    float lastSample;
+    uint64_t key;
+    uint64_t counter;
+};
+
+//------------------------------------------------------------------------
+// DelayEngineState - Filter, resampler and noise memory that goes with a
+// copy of the line
+//------------------------------------------------------------------------
+struct DelayEngineState
+{
+    // Filter and resampler slots, in this order
+    enum { kAntiAliasL, kAntiAliasR, kReconstructL, kReconstructR,
+           kHighPassL, kHighPassR, kLowPassL, kLowPassR, kNumFilters };
+    enum { kDownL, kDownR, kUpL, kUpR, kNumResamplers };
+    
+    double hostSampleRate = 0.0;
+    double internalSampleRate = 24000.0;  // the only rate before it was selectable
+    float filterZ1[kNumFilters] = {};
+    float filterX1[kNumFilters] = {};
+    double resamplerPhase[kNumResamplers] = {};
+    float resamplerLast[kNumResamplers] = {};
+    float resamplerPrev1[kNumResamplers] = {};
+    float resamplerPrev2[kNumResamplers] = {};
+    
+    // Internal samples produced but not yet consumed by the upsamplers
+    enum { kMaxCarry = 2 };
+    int carryCount = 0;
+    float carryL[kMaxCarry] = {};
+    float carryR[kMaxCarry] = {};
+    
+    uint64_t noisePosition = 0;
+};
+
+//------------------------------------------------------------------------
+// DelayLineSnapshot - Delay line contents plus all filter/resampler memory
+// The line is stored unrolled, oldest sample first, so it can be restored
+// into a buffer of a different length by keeping the newest samples.
+//------------------------------------------------------------------------
+struct DelayLineSnapshot : DelayEngineState
+{
+    // Line contents in the format the buffer used: float per channel, or
+    // 12-bit packed frames (3 bytes per stereo frame)
+    bool packed = false;
+    std::vector<float> lineL;
+    std::vector<float> lineR;
+    std::vector<uint8_t> packedLine;
+    
+    int getNumFrames() const
+    {
+        return packed ? static_cast<int>(packedLine.size() / 3) : static_cast<int>(lineL.size());
+    }
 };
 
 //------------------------------------------------------------------------
@@ -150,30 +537,271 @@ public:
     DelayBuffer();
     ~DelayBuffer();
     
-    // Random number generator for dither
-    std::mt19937 rng;
-    std::uniform_real_distribution<float> ditherDist;
+    // Delay line storage
+    // Float32:  full-precision line, quantized only on the way out (default)
+    // Packed12: authentic mode - input is quantized to 12 bits on write and
+    //           stored as packed stereo frames (3 bytes vs. 8 for float)
+    enum class LineFormat { Float32, Packed12 };
+    
+    // Engine quality tier
+    // Eco:      linear resampling, rectangular dither (2 noise values per sample)
+    // Standard: linear resampling, TPDF dither, float character filters
+    // High:     cubic resampling, TPDF dither, double character filters
+    enum class Quality { Eco, Standard, High };
+    
+    // Real-time safe; takes effect at the start of the next sub-block
+    void setQuality(Quality newQuality) { requestedQuality = newQuality; }
+    Quality getQuality() const { return quality; }
+    
+    // Output quantizer resolution in bits (clamped to 8-16, default 12).
+    // Dither stays at half an LSB. Real-time safe; applies immediately.
+    static constexpr int MIN_BIT_DEPTH = 8;
+    static constexpr int MAX_BIT_DEPTH = 16;
+    static constexpr int DEFAULT_BIT_DEPTH = 12;
+    void setBitDepth(int bits);
+    int getBitDepth() const { return bitDepth; }
+    
+    // Internal (sample-rate reduction) rates; 24 kHz is the original unit.
+    // Lower rates cost proportionally less CPU and line memory.
+    static constexpr int NUM_INTERNAL_RATES = 4;
+    static constexpr double INTERNAL_RATES[NUM_INTERNAL_RATES] = { 16000.0, 24000.0, 32000.0, 48000.0 };
+    static constexpr int DEFAULT_INTERNAL_RATE = 1;  // 24 kHz
+    
+    // Index into INTERNAL_RATES. Immediate and, with deferred line
+    // commits, real-time safe: no syscall, allocation or line clearing. A
+    // change forgets the line (its samples are at the old rate), holds one
+    // page of history again and restarts the resampler grid; the pages past
+    // it go back to the OS when serviceLine() next runs, and the delay in
+    // use commits what it needs at the new rate.
+    void setInternalRate(int rateIndex);
+    int getInternalRateIndex() const { return internalRateIndex; }
+    double getInternalRate() const { return internalRate; }
+    
+    // Takes effect at the next prepare(), which sizes the storage
+    void setLineFormat(LineFormat format) { requestedLineFormat = format; }
+    LineFormat getLineFormat() const { return lineFormat; }
+    
+    // Bytes held by the delay line itself (committed pages only)
+    size_t getLineBytes() const;
+    
+    // Frames the line holds as currently grown; at most the prepared maximum
+    int getLineLength() const { return lineLength; }
+    
+    // Line pages are committed as delays need them. By default
+    // processStereo commits them itself, a system call on the calling
+    // thread (offline renders, tools). Deferred, it only posts a request
+    // that serviceLine() carries out on another thread; until those pages
+    // are ready the ring keeps its length, and a longer delay reads
+    // silence past it. Set before prepare().
+    void setDeferredLineCommit(bool deferred) { deferLineCommit = deferred; }
+    bool isLineCommitDeferred() const { return deferLineCommit; }
+    
+    // Commit and touch, or decommit, the pages of a posted request so the
+    // line and capture slots hold what they use, and free pages a restore
+    // swapped out. Not real-time safe; may run concurrently with
+    // processStereo, but not with prepare() or growLineFor().
+    void serviceLine();
+    
+    // Grow the line for delayMs at the current rate right away, so the
+    // first blocks at that delay don't wait for pages. Not real-time safe.
+    void growLineFor(int delayMs);
+    
+    // Back the delay line, and the DSP arena where it is large enough, with
+    // huge pages where supported (next prepare()). Long lines then commit
+    // in 2 MB steps.
+    void setUseHugePages(bool enable) { useHugePages = enable; }
+    
+    // Total memory owned by this instance: object, arena and committed line,
+    // staging and capture pages. Coefficient tables are shared (see
+    // DspTableCache) and not counted.
+    size_t getFootprintBytes() const;
+    
+    // Host samples per internal sub-block. processStereo accepts blocks of
+    // any size and works through them in chunks of this size.
+    static constexpr int REALTIME_CHUNK_SIZE = 1024;  // scratch stays in L1/L2
+    static constexpr int OFFLINE_CHUNK_SIZE = 8192;   // fewer passes per bounce block
+    
+    // Takes effect at the next prepare(), which sizes the scratch buffers
+    void setChunkSize(int hostSamples) { requestedChunkSize = std::max(1, hostSamples); }
+    int getChunkSize() const { return chunkSize; }
     
     // Prepare buffer for given sample rate and max delay
     void prepare(double sampleRate, int maxDelayMs);
     
-    // Process a block of stereo samples with given delay time
-    void processStereo(float* leftIn, float* leftOut,
-                      float* rightIn, float* rightOut,
+    // Process a block of stereo samples with given delay time (any length)
+    void processStereo(const float* leftIn, float* leftOut,
+                      const float* rightIn, float* rightOut,
                       int numSamples, int delayMs);
     
-    // Clear the buffer
+    // Clear the buffer (constant time; the line's history is forgotten,
+    // not zeroed)
     void reset();
     
+    // True if prepare() was already called with these settings
+    bool isPreparedFor(double sampleRate, int maxDelayMs) const;
+    
+    // False before prepare() and after one that threw
+    bool isPrepared() const { return prepared; }
+    
+    // Copy the line and filter state out in one go (resizes the snapshot's
+    // vectors). For when processStereo is not running.
+    void captureSnapshot(DelayLineSnapshot& snapshot) const;
+    
+    // Stage and apply a snapshot in one go, for when processStereo is not
+    // running and no LineWorker services the buffer. Host-rate filter and
+    // resampler state is only restored if the host rate matches.
+    bool restoreSnapshot(const DelayLineSnapshot& snapshot);
+    
+    //--- Session recall while processing ---------------------------------
+    // Neither direction copies a whole line on the audio thread.
+    // Restore: stageSnapshot() lays the line out in spare pages on another
+    // thread, and applyStagedSnapshot() swaps those pages in at a block
+    // start. serviceLine() decommits the pages swapped out.
+    // Capture: with line capture on, updateCapture() copies a slice of the
+    // line per block, oldest frames first, into one of two capture slots
+    // whose pages serviceLine() commits along with the line's. A new copy
+    // starts every CAPTURE_INTERVAL_SECONDS of input and whenever the line
+    // was cleared or replaced; readCapture() takes the newest finished one.
+    
+    // Not real-time safe; may run concurrently with processStereo, not with
+    // prepare(). False if the snapshot's rate is unknown or the OS refuses
+    // the pages.
+    bool stageSnapshot(const DelayLineSnapshot& snapshot);
+    
+    // Real-time safe. 'snapshot' is the one staged, for its filter state.
+    // False if nothing is staged or a page request is still outstanding;
+    // try again at the next block.
+    bool applyStagedSnapshot(const DelayLineSnapshot& snapshot);
+    
+    // Real-time safe. Turning capture off lets serviceLine() decommit the
+    // capture slots.
+    void setLineCapture(bool enable);
+    
+    // Real-time safe; at every block start, capture on or off. Copies up
+    // to maxFrames, plus as many as the last block wrote, so a copy always
+    // outruns the frames it still has to save.
+    void updateCapture(int maxFrames);
+    
+    // Not real-time safe; never waits for the audio thread. False if no
+    // copy has finished since the line was last cleared or replaced.
+    bool readCapture(DelayLineSnapshot& snapshot);
+    
+    static constexpr double CAPTURE_INTERVAL_SECONDS = 1.0;
+    
+    //--- Deterministic rendering -----------------------------------------
+    // The output is a pure function of the input stream, the seed and the
+    // render position, independent of block size. To render a chunk that
+    // starts at host sample N and concatenates with its neighbours:
+    //   reset(); setRenderPosition(N - P); preroll(input[N - P .. N]);
+    // with P = getPrerollSamples(delayMs), then process from N as usual.
+    
+    // Seed the dither/noise stream (the constructor picks a random seed)
+    void setNoiseSeed(uint64_t seed);
+    
+    // Align resampler phases and the noise stream with a single pass that
+    // started at host sample 0. The delay line and filters are untouched.
+    void setRenderPosition(int64_t hostSample);
+    
+    // Host samples of pre-roll needed for the delay line to fill and the
+    // filter memories to settle onto the single-pass trajectory
+    int getPrerollSamples(int delayMs) const;
+    
+    // Run input through the chain and discard the output
+    void preroll(const float* leftIn, const float* rightIn, int numSamples, int delayMs);
+    
+#if WETDELAY_PROFILING
+    // Per-stage timings of processStereo since the last prepare()
+    const StageProfiler& getProfiler() const { return profiler; }
+#endif
+    
 private:
-    // Internal 24 kHz sample rate (authentic 80s rack delay)
-    static constexpr double INTERNAL_SAMPLE_RATE = 24000.0;
+    // Ring growth granularity in frames
+    static constexpr int LINE_PAGE_FRAMES = 4096;
+    
+    // All scratch below is carved from one 64-byte aligned arena in
+    // prepare(); the spans are views into it
+    DspArena arena;
+    bool useHugePages;
+    
+    // Internal sample rate (24 kHz: authentic 80s rack delay)
+    int internalRateIndex;
+    double internalRate;
     
     // Main delay buffer (at internal rate)
-    std::vector<float> bufferL;
-    std::vector<float> bufferR;
+    // prepare() reserves address space for the maximum delay at the
+    // highest internal rate, but commits only the first page. The ring
+    // (lineLength frames) grows in whole pages the first time a delay
+    // needs it; frames older than validFrames read as silence.
+    // Only one of float/packed storage is used, per lineFormat; packed
+    // frames live in lineMemoryL.
+    VirtualBlock lineMemoryL;
+    VirtualBlock lineMemoryR;
+    ArenaSpan<float> bufferL;
+    ArenaSpan<float> bufferR;
+    ArenaSpan<uint8_t> packedBuffer;
+    LineFormat lineFormat;
+    LineFormat requestedLineFormat;
     int writePos;
-    int maxSamples;
+    int lineLength;
+    int validFrames;      // newest frames written since the line was cleared, up to lineLength
+    int maxSamples;       // maximum delay at the current internal rate
+    
+    // Page requests: the audio thread posts (sequence << 32 | frames) and
+    // uses pages past what it had only once serviceLine() has answered that
+    // same sequence. LINE_CAPTURE_FLAG asks for capture slots of the same
+    // size.
+    static constexpr uint32_t LINE_CAPTURE_FLAG = 0x80000000u;
+    bool deferLineCommit;
+    std::atomic<uint64_t> lineRequest;
+    std::atomic<uint64_t> lineReady;
+    uint32_t lineRequestSeq;
+    int lineUsableFrames;  // committed and touched, as far as the audio thread knows
+    int ringTarget;        // length the ring grows to once its pages are ready
+    
+    // Spare pages a snapshot is staged into; the stager owns them, except
+    // while the audio thread swaps them in (Busy). The line they held
+    // afterwards is Spent until serviceLine() decommits it.
+    enum { kStageEmpty, kStageBusy, kStageReady, kStageSpent };
+    VirtualBlock stagedMemoryL;
+    VirtualBlock stagedMemoryR;
+    std::atomic<int> stageState;
+    int stagedLength;      // ring length of the staged line
+    int stagedFrames;      // newest frames it holds, ending at its end
+    int stagedRateIndex;
+    
+    // Capture slots. The audio thread fills an Empty or older Full slot;
+    // readCapture() holds a Full one as Reading while it copies.
+    enum { kSlotEmpty, kSlotFilling, kSlotFull, kSlotReading };
+    static constexpr int NUM_CAPTURE_SLOTS = 2;
+    struct CaptureSlot
+    {
+        VirtualBlock memoryL;  // frames oldest first; packed frames use L only
+        VirtualBlock memoryR;
+        std::atomic<int> state{kSlotEmpty};
+        DelayEngineState engineState;
+        int frames = 0;
+        uint32_t epoch = 0;
+        uint64_t serial = 0;
+    };
+    CaptureSlot captureSlots[NUM_CAPTURE_SLOTS];
+    std::atomic<uint32_t> captureEpoch;  // bumped whenever the line is cleared or replaced
+    bool captureEnabled;
+    bool captureCurrent;       // a copy finished since the last bump
+    int captureUsableFrames;   // slot pages committed and touched, as far as the audio thread knows
+    int captureSlot;           // slot being filled, or -1
+    int captureLength;         // ring length when the copy started
+    int captureValid;          // newest frames of it that were not forgotten
+    int captureDone;           // frames copied so far, oldest first
+    int64_t captureStart;      // lineWritten when the copy started
+    int64_t captureChecked;    // lineWritten at the last updateCapture()
+    int64_t lineWritten;       // frames appended since prepare()
+    uint64_t captureSerial;
+    
+    bool prepared;
+    
+    // Newest frames known to be identical in both line channels
+    int monoFrames;
+    int preparedDelayMs;
     double hostSampleRate;
     
     // Resamplers for down/upsampling
@@ -182,11 +810,49 @@ private:
     LinearResampler upsamplerL;
     LinearResampler upsamplerR;
     
-    // Temporary buffers for resampling
-    std::vector<float> tempDownL;
-    std::vector<float> tempDownR;
-    std::vector<float> tempDelayedL;
-    std::vector<float> tempDelayedR;
+    // Internal samples left at the front of tempDelayedL/R for the next block
+    int upsampleCarry;
+    
+    Quality quality;
+    Quality requestedQuality;
+    
+    // Quantizer grid: 2^bitDepth steps per unit
+    int bitDepth;
+    float quantizeLevels;
+    float invQuantizeLevels;
+    
+    // Shared coefficient tables for every internal rate and tier at the
+    // host rate, so a rate or tier change on the audio thread only swaps
+    // pointers
+    static constexpr int NUM_TIERS = 3;
+    DspTableRef tables[NUM_INTERNAL_RATES][NUM_TIERS];
+    
+    // DspTableCache::Builder for (host rate, internal rate, tier)
+    static void buildTables(DspTableSet& set, double hostRate, double internalRate, int tier);
+    
+    // Host samples per sub-block; scratch buffers are sized for this
+    int chunkSize;
+    int requestedChunkSize;
+    
+    // Dither and noise floor source (6 values per internal sample)
+    NoiseGenerator noise;
+    static constexpr int NOISE_DRAWS_PER_SAMPLE = 6;
+    
+    // Temporary buffers for resampling (internal rate)
+    ArenaSpan<float> tempDownL;
+    ArenaSpan<float> tempDownR;
+    ArenaSpan<float> tempDelayedL;
+    ArenaSpan<float> tempDelayedR;
+    
+    // 12-bit scratch for packed mode: block input and unpacked line reads
+    ArenaSpan<int16_t> tempQuantL;
+    ArenaSpan<int16_t> tempQuantR;
+    ArenaSpan<int16_t> tempUnpackL;
+    ArenaSpan<int16_t> tempUnpackR;
+    
+#if WETDELAY_PROFILING
+    StageProfiler profiler;
+#endif
     
     // Anti-aliasing filter for downsampling (cuts at ~10 kHz before 24 kHz nyquist)
     OnePoleFilter antiAliasL;
@@ -197,7 +863,7 @@ private:
     OnePoleFilter reconstructR;
     
     // Filters: High-pass @ 80Hz, Low-pass @ 9kHz (both 1st-order, 6 dB/oct)
-    // These operate at the internal 24 kHz rate
+    // These operate at the internal rate
     OnePoleFilter highPassL;
     OnePoleFilter highPassR;
     OnePoleFilter lowPassL;
@@ -207,6 +873,8 @@ private:
     static constexpr double HIGH_PASS_FREQ = 80.0;    // 80 Hz - removes low rumble
     static constexpr double LOW_PASS_FREQ = 9000.0;   // 9 kHz - warm high-end rolloff
     static constexpr double ANTI_ALIAS_FREQ = 10000.0; // Anti-aliasing before downsample
+    // Band limits above are for 24 kHz; other internal rates scale the
+    // anti-aliasing cutoff with the rate, and the low-pass only downwards
     
     // Channel crosstalk (authentic 80s analog bleed between L/R)
     // -40 dB = 0.01 (1% bleed) - typical for quality rack units
@@ -215,10 +883,109 @@ private:
     // Convert milliseconds to samples at internal rate
     int msToSamples(int ms) const;
     
-    // Process single sample through delay line (at internal rate)
+    // One sub-block of at most chunkSize samples
+    void processChunk(const float* leftIn, float* leftOut,
+                      const float* rightIn, float* rightOut,
+                      int numSamples, int delaySamples);
+    
+    // Read 'count' delayed frames; frames newer than the line come
+    // straight from the block input in tempDownL/R
+    void readLine(float* outL, float* outR, int count, int delaySamples);
+    
+    // Append the block input (tempDownL/R, or tempQuantL/R when packed)
+    void writeLine(int count);
+    
+    // Append frames [offset, offset + count) of the block input
+    void appendLine(int offset, int count);
+    
+    // Contiguous-or-wrapping span access in the current storage format
+    void readLineSpan(int pos, float* outL, float* outR, int count);
+    void writeLineSpan(int pos, const float* inL, const float* inR,
+                       const int16_t* quantL, const int16_t* quantR, int count);
+    
+    // Whole pages holding 'frames', capped at maxSamples
+    int linePages(int frames) const;
+    
+    // Grow the ring to hold at least 'frames' (capped at maxSamples).
+    // Frames it has already forgotten stay silent. With deferred commits
+    // the ring grows in writeLine() once the pages are ready.
+    void growLine(int frames);
+    
+    // Commit the pages and grow now; false if the OS refuses them
+    bool growLineNow(int frames);
+    
+    // Lengthen the ring, keeping every frame at its age
+    void extendRing(int frames);
+    
+    // Post a page request / pick up the answer to the latest one
+    void requestLine(int frames);
+    void pollLine();
+    
+    // Back to a one-page ring with no history, and ask for the pages past
+    // it to be decommitted
+    void shrinkLine();
+    
+    // Drop the copy in progress and any finished ones
+    void invalidateCapture();
+    
+    // Copy frames [first, first + count) of an unrolled copy of 'length'
+    // frames whose newest 'valid' were real, taken 'written' frames ago
+    void copyLineOut(uint8_t* outL, uint8_t* outR, int length, int valid,
+                     int64_t written, int first, int count) const;
+    
+    // Filter, resampler and noise state in and out of a snapshot
+    void captureEngineState(DelayEngineState& state) const;
+    void applyEngineState(const DelayEngineState& state);
+    
+    // Point bufferL/R or packedBuffer at the first lineLength frames
+    void updateLineSpans();
+    
+    // Set the resampler ratios and delay limit for internalRateIndex, then
+    // apply the tier's tables at that rate
+    void applyInternalRate();
+    
+    // Point filters and resamplers at the requested tier's tables
+    void applyQuality();
+    
+    // Character processing of the delayed block in place (at internal rate).
+    // The filters and noise draws are serial, so they run per sample and
+    // leave the dithered signal in left/right and the noise floor in
+    // tempDownL/R (free once the block is in the line); quantizeBlock()
+    // then finishes the block.
+    template <Quality Q>
+    void processCharacter(float* left, float* right, int count);
+    
+    // Same for identical channels: filters run once on 'left', and only
+    // the dither and noise floor differ between the outputs
+    template <Quality Q>
+    void processCharacterMono(float* left, float* right, int count);
+    
+    // Crosstalk and character filters of one delayed sample, then dither
+    template <Quality Q>
     void processInternalSample(float inputL, float inputR,
-                               float& outputL, float& outputR,
-                               int delaySamples);
+                               float& ditheredL, float& ditheredR,
+                               float& noiseL, float& noiseR);
+    
+    // Dither and noise floor values for one filtered sample
+    template <Quality Q>
+    void ditherSample(float inputL, float inputR,
+                      float& ditheredL, float& ditheredR,
+                      float& noiseL, float& noiseR);
+    
+    // Quantize the dithered block and add the noise floor
+    void quantizeBlock(float* left, float* right, int count);
+    
+    //--- Mono fast path ---------------------------------------------------
+    // A chunk whose channels carry bit-identical input runs the shared part
+    // of the chain (anti-alias, downsample, line, character filters) once.
+    // This is only done while every per-channel state on that path is also
+    // identical, so the result matches stereo processing bit for bit.
+    
+    // True if both channels' pre-quantization state matches for this delay
+    bool channelsShareState(int delaySamples) const;
+    
+    // Update monoFrames after writing 'count' frames from tempDownL/R
+    void trackMonoFrames(int count, bool mono);
 };
 
 //------------------------------------------------------------------------
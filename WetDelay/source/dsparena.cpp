@@ -0,0 +1,232 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "dsparena.h"
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+DspArena::DspArena()
+: base(nullptr)
+, bytes(0)
+, alignment(ALIGNMENT)
+, layoutBytes(0)
+{
+}
+
+//------------------------------------------------------------------------
+DspArena::~DspArena()
+{
+    release();
+}
+
+//------------------------------------------------------------------------
+size_t DspArena::reserve(size_t size)
+{
+    size_t offset = layoutBytes;
+    layoutBytes += (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    return offset;
+}
+
+//------------------------------------------------------------------------
+void DspArena::allocate(bool hugePages)
+{
+    release();
+    if (layoutBytes == 0)
+        return;
+
+    bool useHugePages = hugePages && layoutBytes >= HUGE_PAGE_SIZE;
+    alignment = useHugePages ? HUGE_PAGE_SIZE : ALIGNMENT;
+    bytes = useHugePages ? (layoutBytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1) : layoutBytes;
+
+    base = static_cast<uint8_t*>(::operator new(bytes, std::align_val_t(alignment)));
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (useHugePages)
+        madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+
+    std::memset(base, 0, bytes);
+}
+
+//------------------------------------------------------------------------
+void DspArena::release()
+{
+    if (base)
+        ::operator delete(base, std::align_val_t(alignment));
+    base = nullptr;
+    bytes = 0;
+}
+
+//------------------------------------------------------------------------
+// VirtualBlock
+//------------------------------------------------------------------------
+static size_t systemPageSize()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : 4096;
+#endif
+}
+
+//------------------------------------------------------------------------
+VirtualBlock::VirtualBlock()
+: base(nullptr)
+, reserved(0)
+, committed(0)
+, pageSize(systemPageSize())
+, hugePages(false)
+{
+}
+
+//------------------------------------------------------------------------
+VirtualBlock::~VirtualBlock()
+{
+    release();
+}
+
+//------------------------------------------------------------------------
+void VirtualBlock::reserve(size_t bytes, bool useHugePages)
+{
+    release();
+    if (bytes == 0)
+        return;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    hugePages = useHugePages;
+#else
+    hugePages = false;
+    (void)useHugePages;
+#endif
+    size_t unit = hugePages ? DspArena::HUGE_PAGE_SIZE : pageSize;
+    size_t size = (bytes + unit - 1) / unit * unit;
+#if defined(_WIN32)
+    void* block = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+    if (!block)
+        throw std::bad_alloc();
+#else
+    // Over-reserve by a huge page and trim to an aligned range
+    size_t slack = hugePages ? DspArena::HUGE_PAGE_SIZE : 0;
+    void* block = mmap(nullptr, size + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (block == MAP_FAILED)
+        throw std::bad_alloc();
+    if (slack > 0)
+    {
+        uint8_t* raw = static_cast<uint8_t*>(block);
+        uint8_t* aligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(raw) + slack - 1) & ~(slack - 1));
+        if (aligned > raw)
+            munmap(raw, aligned - raw);
+        if (aligned + size < raw + size + slack)
+            munmap(aligned + size, raw + slack - aligned);
+        block = aligned;
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (hugePages)
+        madvise(block, size, MADV_HUGEPAGE);
+#endif
+#endif
+    base = static_cast<uint8_t*>(block);
+    reserved = size;
+}
+
+//------------------------------------------------------------------------
+void VirtualBlock::release()
+{
+    if (base)
+    {
+#if defined(_WIN32)
+        VirtualFree(base, 0, MEM_RELEASE);
+#else
+        munmap(base, reserved);
+#endif
+    }
+    base = nullptr;
+    reserved = 0;
+    committed = 0;
+    hugePages = false;
+}
+
+//------------------------------------------------------------------------
+size_t VirtualBlock::commitSize(size_t bytes) const
+{
+    size_t unit = (hugePages && bytes >= DspArena::HUGE_PAGE_SIZE / 2) ? DspArena::HUGE_PAGE_SIZE : pageSize;
+    return (bytes + unit - 1) / unit * unit;
+}
+
+//------------------------------------------------------------------------
+bool VirtualBlock::commit(size_t bytes)
+{
+    if (bytes <= committed)
+        return true;
+
+    size_t size = commitSize(bytes);
+    if (!base || size > reserved)
+        return false;
+
+    // Fresh pages come back zeroed from the OS
+    uint8_t* start = base + committed;
+    size_t length = size - committed;
+#if defined(_WIN32)
+    if (!VirtualAlloc(start, length, MEM_COMMIT, PAGE_READWRITE))
+        return false;
+#else
+    if (mprotect(start, length, PROT_READ | PROT_WRITE) != 0)
+        return false;
+#endif
+    committed = size;
+    return true;
+}
+
+//------------------------------------------------------------------------
+void VirtualBlock::decommit(size_t bytes)
+{
+    size_t size = commitSize(bytes);
+    if (!base || size >= committed)
+        return;
+    
+    uint8_t* start = base + size;
+    size_t length = committed - size;
+#if defined(_WIN32)
+    VirtualFree(start, length, MEM_DECOMMIT);
+#else
+    // Mapping fresh inaccessible pages over the range drops the old ones
+    if (mmap(start, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED)
+        return;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // The new mapping does not inherit the advice
+    if (hugePages)
+        madvise(start, length, MADV_HUGEPAGE);
+#endif
+#endif
+    committed = size;
+}
+
+//------------------------------------------------------------------------
+void VirtualBlock::swap(VirtualBlock& other)
+{
+    std::swap(base, other.base);
+    std::swap(reserved, other.reserved);
+    std::swap(committed, other.committed);
+    std::swap(hugePages, other.hugePages);
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
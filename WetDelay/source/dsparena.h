@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// ArenaSpan - Non-owning view of a typed block inside a DspArena
+// Offers the subset of std::vector the DSP code uses.
+//------------------------------------------------------------------------
+template <typename T>
+class ArenaSpan
+{
+public:
+    ArenaSpan() : ptr(nullptr), count(0) {}
+    ArenaSpan(T* data, size_t size) : ptr(data), count(size) {}
+
+    T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+    T& operator[](size_t i) const { return ptr[i]; }
+
+private:
+    T* ptr;
+    size_t count;
+};
+
+//------------------------------------------------------------------------
+// DspArena - One aligned allocation carved into per-instance DSP blocks
+// Usage: beginLayout(), reserve() every block, allocate(), then span()
+// each reserved offset. Every block starts on a cache line, and the
+// memory is zeroed. Allocation only happens in allocate(), so call it
+// from prepare(), never from the audio thread.
+//------------------------------------------------------------------------
+class DspArena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    // Arenas at least this large may be backed by transparent huge pages
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    DspArena();
+    ~DspArena();
+    DspArena(const DspArena&) = delete;
+    DspArena& operator=(const DspArena&) = delete;
+
+    void beginLayout() { layoutBytes = 0; }
+
+    // Returns the offset of a block of 'bytes' in the next allocation
+    size_t reserve(size_t bytes);
+
+    // Replace the current memory with a zeroed block for the layout.
+    // With hugePages, large arenas are aligned to and advised as huge
+    // pages where the OS supports it (Linux); elsewhere it is ignored.
+    void allocate(bool hugePages);
+
+    void release();
+
+    template <typename T>
+    ArenaSpan<T> span(size_t offset, size_t count) const
+    {
+        return ArenaSpan<T>(reinterpret_cast<T*>(base + offset), count);
+    }
+
+    // Bytes currently allocated
+    size_t getBytes() const { return bytes; }
+
+private:
+    uint8_t* base;
+    size_t bytes;
+    size_t alignment;
+    size_t layoutBytes;
+};
+
+//------------------------------------------------------------------------
+// VirtualBlock - Reserved address range committed on demand
+// reserve() only claims address space; commit() backs a prefix of it with
+// zeroed memory. Committing goes to the OS (mprotect / VirtualAlloc) but
+// never to the C++ heap. Memory is charged when first touched, so owners
+// commit and touch pages off the audio thread (see LineWorker) and only
+// as far as they need; a committed prefix is not free.
+// A huge-page block is aligned to HUGE_PAGE_SIZE and advised as huge
+// pages (Linux). Its prefix is committed in normal pages while short, and
+// in whole huge pages once it reaches half of one, so a short delay line
+// stays small and a long one takes a TLB entry per 2 MB.
+//------------------------------------------------------------------------
+class VirtualBlock
+{
+public:
+    VirtualBlock();
+    ~VirtualBlock();
+    VirtualBlock(const VirtualBlock&) = delete;
+    VirtualBlock& operator=(const VirtualBlock&) = delete;
+
+    // Reserve address space, releasing any previous block. Throws
+    // std::bad_alloc if the OS refuses. hugePages is ignored where the OS
+    // has no transparent huge pages.
+    void reserve(size_t bytes, bool hugePages = false);
+    void release();
+
+    // Make [0, bytes) usable. Returns false if the OS is out of memory;
+    // the committed prefix is then unchanged.
+    bool commit(size_t bytes);
+    
+    // Return everything past [0, bytes) to the OS. Committing it again
+    // yields zeroed memory.
+    void decommit(size_t bytes);
+    
+    // Exchange blocks without touching their memory
+    void swap(VirtualBlock& other);
+    
+    // Bytes a prefix of 'bytes' takes once committed: whole OS pages, or
+    // huge pages where those apply
+    size_t commitSize(size_t bytes) const;
+    
+    uint8_t* data() const { return base; }
+    size_t getReservedBytes() const { return reserved; }
+    size_t getCommittedBytes() const { return committed; }
+
+private:
+    uint8_t* base;
+    size_t reserved;
+    size_t committed;
+    size_t pageSize;
+    bool hugePages;
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "dsptables.h"
+#include <cstring>
+#include <mutex>
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// Registry
+// A fixed array of slots, never freed, so lock-free readers can always
+// dereference them. A slot's key only changes under the mutex while no
+// reference to it exists, and its set is freed under the mutex once the
+// last reference is gone; readers only take a reference while the count
+// is non-zero, then re-check the key.
+//------------------------------------------------------------------------
+struct DspTableSlot
+{
+    std::atomic<uint64_t> rateBits{0};
+    std::atomic<uint64_t> internalRateBits{0};
+    std::atomic<int> tier{-1};
+    std::atomic<int> refs{0};
+    std::atomic<DspTableSet*> tables{nullptr};
+};
+
+namespace {
+
+// One instance holds a set per (internal rate, tier) at its host rate
+constexpr int kMaxSlots = 64;
+
+struct Registry
+{
+    DspTableSlot slots[kMaxSlots];
+    std::mutex mutex;
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+uint64_t rateKey(double hostRate)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &hostRate, sizeof(bits));
+    return bits;
+}
+
+bool matches(const DspTableSlot& slot, uint64_t rateBits, uint64_t internalRateBits, int tier)
+{
+    return slot.rateBits.load(std::memory_order_acquire) == rateBits
+        && slot.internalRateBits.load(std::memory_order_acquire) == internalRateBits
+        && slot.tier.load(std::memory_order_acquire) == tier;
+}
+
+// Take a reference only while the slot is live
+bool tryRetain(DspTableSlot& slot)
+{
+    int refs = slot.refs.load(std::memory_order_acquire);
+    while (refs > 0)
+    {
+        if (slot.refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acq_rel))
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+// DspTableSet
+//------------------------------------------------------------------------
+size_t DspTableSet::getBytes() const
+{
+    return (downsampler.phase.capacity() + downsampler.cubic.capacity()
+          + upsampler.phase.capacity() + upsampler.cubic.capacity()) * sizeof(float);
+}
+
+//------------------------------------------------------------------------
+// DspTableRef
+//------------------------------------------------------------------------
+DspTableRef::DspTableRef(DspTableRef&& other) noexcept
+: slot(other.slot)
+, owned(other.owned)
+{
+    other.slot = nullptr;
+    other.owned = nullptr;
+}
+
+//------------------------------------------------------------------------
+DspTableRef& DspTableRef::operator=(DspTableRef&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        slot = other.slot;
+        owned = other.owned;
+        other.slot = nullptr;
+        other.owned = nullptr;
+    }
+    return *this;
+}
+
+//------------------------------------------------------------------------
+void DspTableRef::reset()
+{
+    if (slot)
+        DspTableCache::release(slot);
+    delete owned;
+    slot = nullptr;
+    owned = nullptr;
+}
+
+//------------------------------------------------------------------------
+const DspTableSet* DspTableRef::get() const
+{
+    return slot ? slot->tables.load(std::memory_order_acquire) : owned;
+}
+
+//------------------------------------------------------------------------
+// DspTableCache
+//------------------------------------------------------------------------
+DspTableRef DspTableCache::acquire(double hostRate, double internalRate, int tier, Builder build)
+{
+    Registry& reg = registry();
+    uint64_t rateBits = rateKey(hostRate);
+    uint64_t internalRateBits = rateKey(internalRate);
+    DspTableRef ref;
+
+    // Fast path: share a set another instance holds
+    for (DspTableSlot& slot : reg.slots)
+    {
+        if (!matches(slot, rateBits, internalRateBits, tier) || !tryRetain(slot))
+            continue;
+
+        // The slot may have been reused between the key check and the retain
+        if (matches(slot, rateBits, internalRateBits, tier))
+        {
+            ref.slot = &slot;
+            return ref;
+        }
+        release(&slot);
+    }
+
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // Someone may have built it meanwhile, or its last reference may be
+    // going away; either way the set is still there to use
+    DspTableSlot* freeSlot = nullptr;
+    for (DspTableSlot& slot : reg.slots)
+    {
+        bool live = slot.refs.load(std::memory_order_acquire) > 0;
+        if (matches(slot, rateBits, internalRateBits, tier) && (live || slot.tables.load(std::memory_order_acquire)))
+        {
+            slot.refs.fetch_add(1, std::memory_order_acq_rel);
+            ref.slot = &slot;
+            return ref;
+        }
+        if (!live && !freeSlot)
+            freeSlot = &slot;
+    }
+
+    DspTableSet* tables = new DspTableSet();
+    build(*tables, hostRate, internalRate, tier);
+
+    // Every slot holds a live set: fall back to a private copy
+    if (!freeSlot)
+    {
+        ref.owned = tables;
+        return ref;
+    }
+
+    delete freeSlot->tables.load(std::memory_order_acquire);
+    freeSlot->tables.store(tables, std::memory_order_release);
+    freeSlot->rateBits.store(rateBits, std::memory_order_release);
+    freeSlot->internalRateBits.store(internalRateBits, std::memory_order_release);
+    freeSlot->tier.store(tier, std::memory_order_release);
+    freeSlot->refs.store(1, std::memory_order_release);
+    ref.slot = freeSlot;
+    return ref;
+}
+
+//------------------------------------------------------------------------
+void DspTableCache::release(DspTableSlot* slot)
+{
+    if (slot->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    // Last reference: free the set unless acquire() revived it meanwhile
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    if (slot->refs.load(std::memory_order_acquire) == 0)
+        delete slot->tables.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+//------------------------------------------------------------------------
+int DspTableCache::getNumLiveSets()
+{
+    int count = 0;
+    for (const DspTableSlot& slot : registry().slots)
+        if (slot.refs.load(std::memory_order_acquire) > 0)
+            ++count;
+    return count;
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
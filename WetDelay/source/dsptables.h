@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// ResamplerKernel - Coefficient tables for one reduced resampling ratio
+// Tables are empty for ratios with more than MAX_PHASE_TABLE phases; the
+// resampler then computes the coefficients per sample.
+//------------------------------------------------------------------------
+struct ResamplerKernel
+{
+    int64_t inputStep = 1;
+    int64_t outputStep = 1;
+    std::vector<float> phase;  // p / outputStep for every phase
+    std::vector<float> cubic;  // 4 Lagrange weights for every phase (High tier only)
+};
+
+//------------------------------------------------------------------------
+// OnePoleCoefficients - Coefficient of a OnePoleFilter in both precisions
+//------------------------------------------------------------------------
+struct OnePoleCoefficients
+{
+    float coefficient = 0.0f;
+    double coefficientPrecise = 0.0;
+};
+
+//------------------------------------------------------------------------
+// DspTableSet - Everything DelayBuffer derives from (host rate, internal
+// rate, tier)
+// Immutable once built; shared read-only between instances.
+//------------------------------------------------------------------------
+struct DspTableSet
+{
+    ResamplerKernel downsampler;     // host -> internal rate
+    ResamplerKernel upsampler;       // internal -> host rate
+    OnePoleCoefficients antiAlias;   // at host rate
+    OnePoleCoefficients reconstruct; // at host rate
+    OnePoleCoefficients highPass;    // at internal rate
+    OnePoleCoefficients lowPass;     // at internal rate
+
+    // Heap memory held by the tables
+    size_t getBytes() const;
+};
+
+class DspTableCache;
+struct DspTableSlot;
+
+//------------------------------------------------------------------------
+// DspTableRef - Counted reference to a cached DspTableSet
+// Move-only; releasing the last reference to a set frees it.
+//------------------------------------------------------------------------
+class DspTableRef
+{
+public:
+    DspTableRef() : slot(nullptr), owned(nullptr) {}
+    ~DspTableRef() { reset(); }
+    DspTableRef(DspTableRef&& other) noexcept;
+    DspTableRef& operator=(DspTableRef&& other) noexcept;
+    DspTableRef(const DspTableRef&) = delete;
+    DspTableRef& operator=(const DspTableRef&) = delete;
+
+    void reset();
+
+    const DspTableSet* get() const;
+    const DspTableSet& operator*() const { return *get(); }
+    const DspTableSet* operator->() const { return get(); }
+    explicit operator bool() const { return slot != nullptr || owned != nullptr; }
+
+private:
+    friend class DspTableCache;
+
+    DspTableSlot* slot;  // Shared set
+    DspTableSet* owned;  // Private set, only if the cache is full
+};
+
+//------------------------------------------------------------------------
+// DspTableCache - Process-wide cache of table sets keyed on (host rate,
+// internal rate, tier)
+// The first instance to ask for a key builds its set; every later one
+// shares it. Lookup of a set that is already live is lock-free; building
+// and freeing a set take a mutex. Allocates, so call from prepare(),
+// never from the audio thread.
+//------------------------------------------------------------------------
+class DspTableCache
+{
+public:
+    using Builder = void (*)(DspTableSet& tables, double hostRate, double internalRate, int tier);
+
+    // Shared set for the key, built with 'build' if no instance holds it
+    static DspTableRef acquire(double hostRate, double internalRate, int tier, Builder build);
+
+    // Number of live shared sets (for diagnostics)
+    static int getNumLiveSets();
+
+private:
+    friend class DspTableRef;
+    static void release(DspTableSlot* slot);
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
@@ -3,6 +3,8 @@
 //------------------------------------------------------------------------
 
 #include "ledmeterview.h"
+#include "vstgui/lib/coffscreencontext.h"
+#include <algorithm>
 
 using namespace VSTGUI;
 
@@ -19,6 +21,93 @@ LEDMeterView::LEDMeterView(const CRect& size)
 
 //------------------------------------------------------------------------
 void LEDMeterView::draw(CDrawContext* context)
+{
+    drawRect(context, getViewSize());
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::drawRect(CDrawContext* context, const CRect& updateRect)
+{
+    updateSegmentRects();
+    
+    // Bitmaps are rendered at the context's scale so they stay sharp on HiDPI
+    double scaleFactor = context->getScaleFactor();
+    if (useBitmapCache && (!segmentBitmaps[0] || bitmapScale != scaleFactor))
+    {
+        if (!renderSegmentBitmaps(scaleFactor))
+            useBitmapCache = false;
+    }
+    
+    // Repaint only the segments inside the invalidated area
+    int litCount = getLitCount();
+    for (int i = 0; i < numSegments; i++)
+    {
+        if (segmentRects[i].rectOverlap(updateRect))
+            drawSegment(context, i, i < litCount);
+    }
+    
+    drawnLitCount = litCount;
+    setDirty(false);
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::drawSegment(CDrawContext* context, int segmentIndex, bool lit)
+{
+    const CRect& segRect = segmentRects[segmentIndex];
+    if (useBitmapCache)
+    {
+        CRect viewSize = getViewSize();
+        CPoint offset(segRect.left - viewSize.left, segRect.top - viewSize.top);
+        context->drawBitmap(segmentBitmaps[lit ? 1 : 0], segRect, offset);
+    }
+    else
+    {
+        context->setFillColor(lit ? getLitColor(segmentIndex) : getDarkColor(segmentIndex));
+        context->drawRect(segRect, kDrawFilled);
+    }
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::invalid()
+{
+    // Nothing on screen to compare against yet: repaint everything
+    if (drawnLitCount < 0 || static_cast<int>(segmentRects.size()) != numSegments)
+    {
+        CControl::invalid();
+        return;
+    }
+    
+    // Only the segments between the drawn and the new level change state,
+    // and they are adjacent
+    setDirty(false);
+    int litCount = getLitCount();
+    if (litCount == drawnLitCount)
+        return;
+    
+    int first = std::min(litCount, drawnLitCount);
+    int last = std::max(litCount, drawnLitCount) - 1;
+    CRect dirty = segmentRects[first];
+    dirty.unite(segmentRects[last]);
+    invalidRect(dirty);
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::setViewSize(const CRect& rect, bool invalid)
+{
+    invalidateGeometry();
+    CControl::setViewSize(rect, invalid);
+}
+
+//------------------------------------------------------------------------
+bool LEDMeterView::removed(CView* parent)
+{
+    // Release the bitmaps while the editor is closed
+    invalidateGeometry();
+    return CControl::removed(parent);
+}
+
+//------------------------------------------------------------------------
+int LEDMeterView::getLitCount() const
 {
     // Get normalized value (0.0 to 1.0)
     float level = getValueNormalized();
@@ -27,18 +116,53 @@ void LEDMeterView::draw(CDrawContext* context)
     int litCount = static_cast<int>(level * numSegments + 0.5f);
     if (litCount > numSegments) litCount = numSegments;
     if (litCount < 0) litCount = 0;
+    return litCount;
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::invalidateGeometry()
+{
+    segmentRects.clear();
+    segmentBitmaps[0] = nullptr;
+    segmentBitmaps[1] = nullptr;
+    bitmapScale = 0.0;
+    drawnLitCount = -1;
+}
+
+//------------------------------------------------------------------------
+void LEDMeterView::updateSegmentRects()
+{
+    if (static_cast<int>(segmentRects.size()) == numSegments)
+        return;
     
-    // Draw each segment
+    segmentRects.resize(numSegments);
     for (int i = 0; i < numSegments; i++)
+        segmentRects[i] = calculateSegmentRect(i);
+}
+
+//------------------------------------------------------------------------
+bool LEDMeterView::renderSegmentBitmaps(double scaleFactor)
+{
+    CRect viewSize = getViewSize();
+    for (int lit = 0; lit < 2; lit++)
     {
-        CRect segRect = calculateSegmentRect(i);
-        CColor color = (i < litCount) ? getLitColor(i) : getDarkColor(i);
+        auto offscreen = COffscreenContext::create(viewSize.getSize(), scaleFactor);
+        if (!offscreen)
+            return false;
         
-        context->setFillColor(color);
-        context->drawRect(segRect, kDrawFilled);
+        offscreen->beginDraw();
+        for (int i = 0; i < numSegments; i++)
+        {
+            CRect segRect = segmentRects[i];
+            segRect.offset(-viewSize.left, -viewSize.top);
+            offscreen->setFillColor(lit ? getLitColor(i) : getDarkColor(i));
+            offscreen->drawRect(segRect, kDrawFilled);
+        }
+        offscreen->endDraw();
+        segmentBitmaps[lit] = offscreen->getBitmap();
     }
-    
-    setDirty(false);
+    bitmapScale = scaleFactor;
+    return true;
 }
 
 //------------------------------------------------------------------------
@@ -7,12 +7,17 @@
 #include "vstgui/lib/cview.h"
 #include "vstgui/lib/controls/ccontrol.h"
 #include "vstgui/lib/cdrawcontext.h"
+#include "vstgui/lib/cbitmap.h"
+#include <vector>
 
 namespace Yonie {
 
 //------------------------------------------------------------------------
 // LEDMeterView - Custom 80's style LED segment meter
 // Displays 12 discrete LED segments: 8 green, 2 yellow, 2 red
+// A value change only invalidates the segments that switch on or off, and
+// drawing only repaints the segments inside the update rect, blitting them
+// from pre-rendered lit/dark strips when the bitmap cache is on.
 //------------------------------------------------------------------------
 class LEDMeterView : public VSTGUI::CControl
 {
@@ -22,11 +27,20 @@ public:
 
     // CView overrides
     void draw(VSTGUI::CDrawContext* context) override;
+    void drawRect(VSTGUI::CDrawContext* context, const VSTGUI::CRect& updateRect) override;
+    void invalid() override;
+    void setViewSize(const VSTGUI::CRect& rect, bool invalid = true) override;
+    bool removed(VSTGUI::CView* parent) override;
     
     // Configuration
-    void setNumSegments(int num) { numSegments = num; }
-    void setSegmentGap(VSTGUI::CCoord gap) { segmentGap = gap; }
-    void setHorizontal(bool horiz) { isHorizontal = horiz; }
+    void setNumSegments(int num) { numSegments = num; invalidateGeometry(); }
+    void setSegmentGap(VSTGUI::CCoord gap) { segmentGap = gap; invalidateGeometry(); }
+    void setHorizontal(bool horiz) { isHorizontal = horiz; invalidateGeometry(); }
+    
+    // Draw segments from pre-rendered lit/dark bitmaps (default on); falls
+    // back to filled rects if no offscreen context is available
+    void setUseBitmapCache(bool use) { useBitmapCache = use; invalidateGeometry(); }
+    bool getUseBitmapCache() const { return useBitmapCache; }
     
     // Custom view class name for VSTGUI factory
     CLASS_METHODS(LEDMeterView, CControl)
@@ -36,9 +50,28 @@ protected:
     VSTGUI::CColor getLitColor(int segmentIndex) const;
     VSTGUI::CColor getDarkColor(int segmentIndex) const;
     
+    // Segments lit for the current value
+    int getLitCount() const;
+    
+    // Drop cached geometry and bitmaps; the next invalid() repaints all
+    void invalidateGeometry();
+    void updateSegmentRects();
+    bool renderSegmentBitmaps(double scaleFactor);
+    void drawSegment(VSTGUI::CDrawContext* context, int segmentIndex, bool lit);
+    
     int numSegments = 12;
     VSTGUI::CCoord segmentGap = 2;
     bool isHorizontal = true;
+    bool useBitmapCache = true;
+    
+    // Cached per geometry: segment rects and the whole meter drawn fully
+    // dark [0] and fully lit [1], at bitmapScale
+    std::vector<VSTGUI::CRect> segmentRects;
+    VSTGUI::SharedPointer<VSTGUI::CBitmap> segmentBitmaps[2];
+    double bitmapScale = 0.0;
+    
+    // Lit count on screen, or -1 if the view needs a full repaint
+    int drawnLitCount = -1;
     
     // Color definitions for 80's LED look
     // Green zone (segments 0-7)
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "lineworker.h"
+#include "delaybuffer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Yonie {
+
+namespace {
+
+// Pages are ready within about this long of being asked for
+constexpr int kPollMs = 5;
+
+//------------------------------------------------------------------------
+// Buffers are serviced under the mutex, so remove() cannot return while
+// one is in progress. A thread runs until the generation it was started
+// with ends, which happens when the last buffer is removed; a buffer
+// added meanwhile starts a new one.
+//------------------------------------------------------------------------
+struct Worker
+{
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<DelayBuffer*> buffers;
+    std::thread thread;
+    uint64_t generation = 0;
+};
+
+Worker& worker()
+{
+    static Worker instance;
+    return instance;
+}
+
+void run(uint64_t generation)
+{
+    Worker& w = worker();
+    std::unique_lock<std::mutex> lock(w.mutex);
+    while (w.generation == generation)
+    {
+        for (DelayBuffer* buffer : w.buffers)
+            buffer->serviceLine();
+        w.wake.wait_for(lock, std::chrono::milliseconds(kPollMs));
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+void LineWorker::add(DelayBuffer* buffer)
+{
+    Worker& w = worker();
+    std::lock_guard<std::mutex> lock(w.mutex);
+    if (std::find(w.buffers.begin(), w.buffers.end(), buffer) != w.buffers.end())
+        return;
+    
+    w.buffers.push_back(buffer);
+    if (!w.thread.joinable())
+        w.thread = std::thread(run, w.generation);
+}
+
+//------------------------------------------------------------------------
+void LineWorker::remove(DelayBuffer* buffer)
+{
+    Worker& w = worker();
+    std::thread finished;
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.buffers.erase(std::remove(w.buffers.begin(), w.buffers.end(), buffer), w.buffers.end());
+        if (!w.buffers.empty() || !w.thread.joinable())
+            return;
+        
+        // Stop the thread while nothing is registered; joining happens
+        // outside the lock, so a concurrent add() is not held up
+        ++w.generation;
+        finished = std::move(w.thread);
+    }
+    w.wake.notify_all();
+    finished.join();
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
@@ -0,0 +1,29 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+namespace Yonie {
+
+class DelayBuffer;
+
+//------------------------------------------------------------------------
+// LineWorker - Process-wide thread that commits delay line pages
+// A DelayBuffer with deferred line commits only posts page requests from
+// the audio thread. The worker polls every registered buffer a few times
+// per block period and carries them out with DelayBuffer::serviceLine().
+// Its thread runs while at least one buffer is registered. Not real-time
+// safe: call from setActive(), never from process().
+//------------------------------------------------------------------------
+class LineWorker
+{
+public:
+    static void add(DelayBuffer* buffer);
+    
+    // Returns once no service of the buffer is in progress
+    static void remove(DelayBuffer* buffer);
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+// Per-stage DSP timing. Compiled in only with WETDELAY_PROFILING=1
+// (CMake option WETDELAY_ENABLE_PROFILING); otherwise the macros below
+// expand to nothing and DelayBuffer carries no profiler at all.
+#ifndef WETDELAY_PROFILING
+#define WETDELAY_PROFILING 0
+#endif
+
+#if WETDELAY_PROFILING
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WETDELAY_PROFILE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define WETDELAY_PROFILE_RDTSC 1
+#else
+#include <chrono>
+#define WETDELAY_PROFILE_RDTSC 0
+#endif
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// Processing stages of DelayBuffer::processStereo, in order
+// The host-rate filters run inside the resampling passes, so Downsample
+// includes the anti-alias filter and Upsample the reconstruction filter.
+//------------------------------------------------------------------------
+enum class DspStage
+{
+    Downsample,
+    DelayLine,
+    Character,
+    Upsample,
+    Count
+};
+
+//------------------------------------------------------------------------
+// StageProfile - Copy of one stage's counters
+// Ticks are TSC cycles on x86, steady_clock nanoseconds elsewhere.
+//------------------------------------------------------------------------
+struct StageProfile
+{
+    // Bucket b counts calls that took [2^b, 2^(b+1)) ticks (bucket 0 also holds 0)
+    static constexpr int kNumBuckets = 32;
+
+    uint64_t calls = 0;
+    uint64_t ticks = 0;
+    uint32_t histogram[kNumBuckets] = {};
+};
+
+//------------------------------------------------------------------------
+// StageProfiler - Lock-free per-instance stage timings
+// The audio thread is the only writer, so counters are updated with plain
+// relaxed load/store pairs (no locked read-modify-write); any thread may
+// read them at any time. Reads of a running profiler are per-counter
+// consistent only.
+//------------------------------------------------------------------------
+class StageProfiler
+{
+public:
+    static uint64_t now()
+    {
+#if WETDELAY_PROFILE_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Charge the time since 'start' to a stage; returns the new timestamp
+    // so consecutive stages can chain off a single clock read
+    uint64_t record(DspStage stage, uint64_t start)
+    {
+        uint64_t end = now();
+        uint64_t elapsed = end - start;
+        Counters& c = counters[static_cast<int>(stage)];
+
+        int bucket = 0;
+        while (bucket < StageProfile::kNumBuckets - 1 && (elapsed >> (bucket + 1)) != 0)
+            ++bucket;
+
+        c.calls.store(c.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        c.ticks.store(c.ticks.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+        c.histogram[bucket].store(c.histogram[bucket].load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+        return end;
+    }
+
+    void read(DspStage stage, StageProfile& profile) const
+    {
+        const Counters& c = counters[static_cast<int>(stage)];
+        profile.calls = c.calls.load(std::memory_order_relaxed);
+        profile.ticks = c.ticks.load(std::memory_order_relaxed);
+        for (int b = 0; b < StageProfile::kNumBuckets; ++b)
+            profile.histogram[b] = c.histogram[b].load(std::memory_order_relaxed);
+    }
+
+    // Only while the audio thread is not processing (e.g. from prepare)
+    void reset()
+    {
+        for (Counters& c : counters)
+        {
+            c.calls.store(0, std::memory_order_relaxed);
+            c.ticks.store(0, std::memory_order_relaxed);
+            for (auto& h : c.histogram)
+                h.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static const char* stageName(DspStage stage)
+    {
+        static const char* const names[] = {
+            "anti-alias + downsample", "delay line", "character", "upsample + reconstruction"
+        };
+        return names[static_cast<int>(stage)];
+    }
+
+private:
+    struct Counters
+    {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint32_t> histogram[StageProfile::kNumBuckets] = {};
+    };
+
+    Counters counters[static_cast<int>(DspStage::Count)];
+};
+
+//------------------------------------------------------------------------
+} // namespace Yonie
+
+// Start a timing chain in the current scope, then charge each stage as it ends
+#define WETDELAY_PROFILE_START() uint64_t profileMark = StageProfiler::now()
+#define WETDELAY_PROFILE_STAGE(stage) profileMark = profiler.record(DspStage::stage, profileMark)
+
+#else
+
+#define WETDELAY_PROFILE_START() ((void)0)
+#define WETDELAY_PROFILE_STAGE(stage) ((void)0)
+
+#endif // WETDELAY_PROFILING
@@ -27,9 +27,69 @@ enum WetDelayParams : Steinberg::Vst::ParamID
 	kOutputMeterL = 3,
 	kOutputMeterR = 4,
 	
-	kParamCount = 5
+	// Store the delay line contents with the session (0 = off, 1 = on)
+	kRecallParam = 5,
+	
+	// Delay line storage (0 = float, 1 = 12-bit packed), applied on activation
+	kLineStorageParam = 6,
+	
+	// Engine quality (0 = eco, 1 = standard, 2 = high, 3 = auto)
+	kQualityParam = 7,
+	
+	// Delay time multiplier (0-4 = x1, x2, x5, x10, x25)
+	kDelayMultiplierParam = 8,
+	
+	// Output quantizer resolution (0-8 = 8-16 bits)
+	kBitDepthParam = 9,
+	
+	// Internal sample rate (0-3 = 16, 24, 32, 48 kHz)
+	kInternalRateParam = 10,
+	
+	// Editor meter refresh rate (0-1 = 30, 60 fps); controller only
+	kMeterRefreshParam = 11,
+	
+	// Host bypass (0 = off, 1 = on); the delay tail plays out
+	kBypassParam = 12,
+	
+	kParamCount = 13
 };
 
+// Number of selectable delay times (kDelayTimeParam steps + 1)
+static const int kNumDelayTimes = 6;
+
+// Number of delay time multipliers (kDelayMultiplierParam steps + 1)
+static const int kNumDelayMultipliers = 5;
+
+// Selectable bit depths (kBitDepthParam steps + 1), from kMinBitDepth up
+static const int kMinBitDepth = 8;
+static const int kNumBitDepths = 9;
+static const int kDefaultBitDepth = 12;
+
+// Selectable internal sample rates (kInternalRateParam steps + 1)
+static const int kNumInternalRates = 4;
+static const int kDefaultInternalRate = 1;  // 24 kHz
+
+// Editor meter refresh rates in frames per second (kMeterRefreshParam steps + 1)
+static const int kNumMeterRefreshRates = 2;
+static const int kMeterRefreshRates[kNumMeterRefreshRates] = { 30, 60 };
+static const int kDefaultMeterRefresh = 0;  // 30 fps
+
+// Engine quality modes (kQualityParam steps + 1)
+enum QualityModes
+{
+	kQualityEco = 0,
+	kQualityStandard = 1,
+	kQualityHigh = 2,
+	kQualityAuto = 3,
+	kNumQualityModes = 4
+};
+
+#if WETDELAY_PROFILING
+// Processor -> controller message carrying StageProfile[DspStage::Count]
+static const char* const kStageProfileMessage = "StageProfile";
+static const char* const kStageProfileAttr = "profiles";
+#endif
+
 // Button control tags (100-105 for the 6 delay buttons)
 enum ButtonTags
 {
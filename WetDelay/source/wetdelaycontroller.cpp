@@ -5,8 +5,15 @@
 #include "wetdelaycontroller.h"
 #include "wetdelaycids.h"
 #include "vstgui/plugin-bindings/vst3editor.h"
-#include "base/source/fstreamer.h"
+#include "wetdelaystate.h"
 #include "customviewcreator.h"
+#include "backplateview.h"
+#include <algorithm>
+#include <cstring>
+
+#if SMTG_OS_WINDOWS
+#include <windows.h>
+#endif
 
 using namespace Steinberg;
 
@@ -43,6 +50,136 @@ tresult PLUGIN_API WetDelayProcessorController::initialize (FUnknown* context)
 	
 	parameters.addParameter(delayParam);
 	
+	// Stretches the selected delay time, up to 10 s
+	Vst::StringListParameter* multiplierParam = new Vst::StringListParameter(
+		STR16("Time Multiplier"),
+		kDelayMultiplierParam,
+		nullptr,
+		Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList
+	);
+	
+	multiplierParam->appendString(STR16("x1"));
+	multiplierParam->appendString(STR16("x2"));
+	multiplierParam->appendString(STR16("x5"));
+	multiplierParam->appendString(STR16("x10"));
+	multiplierParam->appendString(STR16("x25"));
+	
+	parameters.addParameter(multiplierParam);
+	
+	// Resolution of the output quantizer; 12 bits matches the original unit
+	Vst::StringListParameter* bitDepthParam = new Vst::StringListParameter(
+		STR16("Bit Depth"),
+		kBitDepthParam,
+		nullptr,
+		Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList
+	);
+	
+	bitDepthParam->appendString(STR16("8 bit"));
+	bitDepthParam->appendString(STR16("9 bit"));
+	bitDepthParam->appendString(STR16("10 bit"));
+	bitDepthParam->appendString(STR16("11 bit"));
+	bitDepthParam->appendString(STR16("12 bit"));
+	bitDepthParam->appendString(STR16("13 bit"));
+	bitDepthParam->appendString(STR16("14 bit"));
+	bitDepthParam->appendString(STR16("15 bit"));
+	bitDepthParam->appendString(STR16("16 bit"));
+	
+	Vst::ParamValue defaultBitDepth = bitDepthParam->toNormalized(kDefaultBitDepth - kMinBitDepth);
+	bitDepthParam->getInfo().defaultNormalizedValue = defaultBitDepth;
+	bitDepthParam->setNormalized(defaultBitDepth);
+	
+	parameters.addParameter(bitDepthParam);
+	
+	// Sample-rate reduction: lower rates sound darker and cost less
+	Vst::StringListParameter* internalRateParam = new Vst::StringListParameter(
+		STR16("Internal Rate"),
+		kInternalRateParam,
+		nullptr,
+		Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsList
+	);
+	
+	internalRateParam->appendString(STR16("16 kHz"));
+	internalRateParam->appendString(STR16("24 kHz"));
+	internalRateParam->appendString(STR16("32 kHz"));
+	internalRateParam->appendString(STR16("48 kHz"));
+	
+	Vst::ParamValue defaultInternalRate = internalRateParam->toNormalized(kDefaultInternalRate);
+	internalRateParam->getInfo().defaultNormalizedValue = defaultInternalRate;
+	internalRateParam->setNormalized(defaultInternalRate);
+	
+	parameters.addParameter(internalRateParam);
+	
+	// Session recall stores the delay line contents with the project
+	Vst::StringListParameter* recallParam = new Vst::StringListParameter(
+		STR16("Session Recall"),
+		kRecallParam,
+		nullptr,
+		Vst::ParameterInfo::kIsList
+	);
+	
+	recallParam->appendString(STR16("Off"));
+	recallParam->appendString(STR16("On"));
+	
+	parameters.addParameter(recallParam);
+	
+	// Authentic mode keeps the line as packed 12-bit words, like the original
+	// hardware; applied the next time processing is set up
+	Vst::StringListParameter* storageParam = new Vst::StringListParameter(
+		STR16("Line Storage"),
+		kLineStorageParam,
+		nullptr,
+		Vst::ParameterInfo::kIsList
+	);
+	
+	storageParam->appendString(STR16("Float"));
+	storageParam->appendString(STR16("12-bit Packed"));
+	
+	parameters.addParameter(storageParam);
+	
+	// Engine quality; Auto steps down a tier when a block runs close to
+	// its real-time budget and back up once there is headroom again
+	Vst::StringListParameter* qualityParam = new Vst::StringListParameter(
+		STR16("Engine Quality"),
+		kQualityParam,
+		nullptr,
+		Vst::ParameterInfo::kIsList
+	);
+	
+	qualityParam->appendString(STR16("Eco"));
+	qualityParam->appendString(STR16("Standard"));
+	qualityParam->appendString(STR16("High"));
+	qualityParam->appendString(STR16("Auto"));
+	
+	Vst::ParamValue standardQuality = qualityParam->toNormalized(kQualityStandard);
+	qualityParam->getInfo().defaultNormalizedValue = standardQuality;
+	qualityParam->setNormalized(standardQuality);
+	
+	parameters.addParameter(qualityParam);
+	
+	// How often open editors repaint the meters; editor only, saved with
+	// the controller state. Hidden and not automatable, so hosts neither
+	// list it nor record its edits
+	Vst::StringListParameter* refreshParam = new Vst::StringListParameter(
+		STR16("Meter Refresh"),
+		kMeterRefreshParam,
+		nullptr,
+		Vst::ParameterInfo::kIsList | Vst::ParameterInfo::kIsHidden
+	);
+	
+	refreshParam->appendString(STR16("30 fps"));
+	refreshParam->appendString(STR16("60 fps"));
+	
+	Vst::ParamValue defaultRefresh = refreshParam->toNormalized(kDefaultMeterRefresh);
+	refreshParam->getInfo().defaultNormalizedValue = defaultRefresh;
+	refreshParam->setNormalized(defaultRefresh);
+	
+	parameters.addParameter(refreshParam);
+	
+	// Host bypass: hosts show it as the plug-in's bypass switch and leave
+	// the transition, including the delay tail, to the processor
+	parameters.addParameter(STR16("Bypass"), nullptr, 1, 0,
+		Vst::ParameterInfo::kCanAutomate | Vst::ParameterInfo::kIsBypass, kBypassParam);
+	
 	// Register read-only meter parameters for UI display
 	parameters.addParameter(STR16("Input Meter L"), nullptr, 0, 0,
 		Vst::ParameterInfo::kIsReadOnly, kInputMeterL);
@@ -60,6 +197,13 @@ tresult PLUGIN_API WetDelayProcessorController::initialize (FUnknown* context)
 tresult PLUGIN_API WetDelayProcessorController::terminate ()
 {
 	// Here the Plug-in will be de-instantiated, last possibility to remove some memory!
+	refreshTimer = nullptr;
+	openEditors.clear();
+	if (holdsBackplate)
+	{
+		BackplateCache::release();
+		holdsBackplate = false;
+	}
 
 	//---do not forget to call parent ------
 	return EditControllerEx1::terminate ();
@@ -72,15 +216,22 @@ tresult PLUGIN_API WetDelayProcessorController::setComponentState (IBStream* sta
 	if (!state)
 		return kResultFalse;
 
-	IBStreamer streamer(state, kLittleEndian);
-	
-	int32 savedDelayIndex = 0;
-	if (streamer.readInt32(savedDelayIndex) == kResultTrue)
-	{
-		currentDelayIndex = savedDelayIndex;
-		// Convert index to normalized value and set parameter
-		setParamNormalized(kDelayTimeParam, savedDelayIndex / 5.0);
-	}
+	// Same chunk format and validation as the processor
+	WetDelayStateData data;
+	data.delayIndex = currentDelayIndex;
+	if (!readWetDelayState(state, data))
+		return kResultFalse;
+
+	currentDelayIndex = data.delayIndex;
+	// Convert index to normalized value and set parameter
+	setParamNormalized(kDelayTimeParam, data.delayIndex / 5.0);
+	setParamNormalized(kRecallParam, data.recall);
+	setParamNormalized(kLineStorageParam, data.lineStorage);
+	setParamNormalized(kQualityParam, data.quality / static_cast<double>(kNumQualityModes - 1));
+	setParamNormalized(kDelayMultiplierParam, data.delayMultiplier / static_cast<double>(kNumDelayMultipliers - 1));
+	setParamNormalized(kBitDepthParam, (data.bitDepth - kMinBitDepth) / static_cast<double>(kNumBitDepths - 1));
+	setParamNormalized(kInternalRateParam, data.internalRate / static_cast<double>(kNumInternalRates - 1));
+	setParamNormalized(kBypassParam, data.bypass);
 
 	return kResultOk;
 }
@@ -89,7 +240,29 @@ tresult PLUGIN_API WetDelayProcessorController::setComponentState (IBStream* sta
 tresult PLUGIN_API WetDelayProcessorController::setState (IBStream* state)
 {
 	// Here you get the state of the controller
+	// Unknown fields are skipped so future UI settings can be added
+	// without breaking older sessions
+	if (!state)
+		return kResultFalse;
+
+	// Sessions saved before 1.2 carry an empty controller chunk
+	StateReader reader(state);
+	int32 legacyValue = 0;
+	if (reader.open(legacyValue) != StateReader::Format::Versioned)
+		return kResultTrue;
 
+	int32 refresh = meterRefreshIndex;
+	uint32 id, length;
+	while (reader.nextField(id, length))
+	{
+		if (id == StateFormat::kFieldMeterRefresh && !reader.readInt32(refresh))
+			return kResultFalse;
+	}
+
+	if (!reader.finish() || refresh < 0 || refresh >= kNumMeterRefreshRates)
+		return kResultFalse;
+
+	setParamNormalized(kMeterRefreshParam, refresh / static_cast<double>(kNumMeterRefreshRates - 1));
 	return kResultTrue;
 }
 
@@ -98,10 +271,142 @@ tresult PLUGIN_API WetDelayProcessorController::getState (IBStream* state)
 {
 	// Here you are asked to deliver the state of the controller (if needed)
 	// Note: the real state of your plug-in is saved in the processor
+	StateWriter writer(state);
+	if (!writer.begin()
+		|| !writer.writeInt32Field(StateFormat::kFieldMeterRefresh, meterRefreshIndex)
+		|| !writer.finish())
+		return kResultFalse;
 
 	return kResultTrue;
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayProcessorController::setParamNormalized (Vst::ParamID tag, Vst::ParamValue value)
+{
+	// Meters arrive once per processed block; while an editor is open keep
+	// only the latest value and let the refresh timer pass it on
+	if (tag >= kInputMeterL && tag <= kOutputMeterR && refreshTimer)
+	{
+		int meter = static_cast<int>(tag - kInputMeterL);
+		meterValues[meter] = value;
+		meterPending[meter] = true;
+		return kResultOk;
+	}
+
+	tresult result = EditControllerEx1::setParamNormalized (tag, value);
+	if (tag == kMeterRefreshParam && result == kResultOk)
+	{
+		int index = static_cast<int>(value * (kNumMeterRefreshRates - 1) + 0.5);
+		meterRefreshIndex = std::min(std::max(index, 0), kNumMeterRefreshRates - 1);
+		updateRefreshTimer ();
+	}
+	return result;
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorController::didOpen (VSTGUI::VST3Editor* editor)
+{
+	openEditors.push_back (editor);
+	if (refreshTimer)
+		return;
+
+	// One timer per controller, whatever the host's block size; it is
+	// stopped while no editor has area and skips ticks while the host
+	// window is hidden or minimised
+	refreshTimer = VSTGUI::makeOwned<VSTGUI::CVSTGUITimer> (
+		[this] (VSTGUI::CVSTGUITimer*) {
+			if (isAnyEditorVisible ())
+				flushMeters ();
+		},
+		1000 / kMeterRefreshRates[meterRefreshIndex], false);
+	updateRefreshTimer ();
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorController::editorResized ()
+{
+	updateRefreshTimer ();
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorController::willClose (VSTGUI::VST3Editor* editor)
+{
+	openEditors.erase (std::remove (openEditors.begin (), openEditors.end (), editor), openEditors.end ());
+	if (!refreshTimer)
+		return;
+	if (!openEditors.empty ())
+	{
+		updateRefreshTimer ();
+		return;
+	}
+
+	// Leave the parameters at their latest values for the next editor
+	refreshTimer->stop ();
+	refreshTimer = nullptr;
+	flushMeters ();
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorController::flushMeters ()
+{
+	for (int i = 0; i < kNumMeters; ++i)
+	{
+		if (!meterPending[i])
+			continue;
+		meterPending[i] = false;
+		EditControllerEx1::setParamNormalized (kInputMeterL + i, meterValues[i]);
+	}
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorController::updateRefreshTimer ()
+{
+	if (!refreshTimer)
+		return;
+
+	refreshTimer->setFireTime (1000 / kMeterRefreshRates[meterRefreshIndex]);
+	bool anyArea = std::any_of (openEditors.begin (), openEditors.end (), [] (VSTGUI::VST3Editor* editor) {
+		auto* wetEditor = dynamic_cast<WetDelayEditor*> (editor);
+		return wetEditor && wetEditor->hasArea ();
+	});
+	if (anyArea)
+		refreshTimer->start ();
+	else
+		refreshTimer->stop ();
+}
+
+//------------------------------------------------------------------------
+bool WetDelayProcessorController::isAnyEditorVisible () const
+{
+	for (VSTGUI::VST3Editor* editor : openEditors)
+	{
+		auto* wetEditor = dynamic_cast<WetDelayEditor*> (editor);
+		if (wetEditor && wetEditor->isShowing ())
+			return true;
+	}
+	return false;
+}
+
+#if WETDELAY_PROFILING
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayProcessorController::notify (Vst::IMessage* message)
+{
+	if (!message || std::strcmp (message->getMessageID (), kStageProfileMessage) != 0)
+		return EditControllerEx1::notify (message);
+
+	const void* data = nullptr;
+	uint32 size = 0;
+	if (message->getAttributes ()->getBinary (kStageProfileAttr, data, size) != kResultOk
+		|| size != sizeof (stageProfiles))
+		return kResultFalse;
+
+	// Read through getStageProfile (stageprofilebench prints the same
+	// counters for the bare DelayBuffer)
+	std::memcpy (stageProfiles, data, size);
+	return kResultOk;
+}
+#endif
+
 //------------------------------------------------------------------------
 void WetDelayProcessorController::setDelayIndexFromUI(int index)
 {
@@ -128,13 +433,70 @@ IPlugView* PLUGIN_API WetDelayProcessorController::createView (FIDString name)
 	// Here the Host wants to open your editor (if you have one)
 	if (FIDStringsEqual (name, Vst::ViewType::kEditor))
 	{
+		// GUI setup happens here, on the first editor, so scanning and
+		// headless rendering never pay for it
+		registerCustomViews();
+		
+		// Keep the decoded backplate for as long as this instance lives, so
+		// closing and reopening the editor doesn't decode it again
+		if (!holdsBackplate)
+		{
+			BackplateCache::retain();
+			holdsBackplate = true;
+		}
+		
 		// create your editor here and return a IPlugView ptr of it
-		auto* view = new VSTGUI::VST3Editor (this, "view", "wetdelayeditor.uidesc");
+		auto* view = new WetDelayEditor (this, "view", "wetdelayeditor.uidesc");
 		return view;
 	}
 	return nullptr;
 }
 
+//------------------------------------------------------------------------
+// WetDelayEditor Implementation
+//------------------------------------------------------------------------
+bool WetDelayEditor::isShowing () const
+{
+	VSTGUI::CFrame* frame = getFrame ();
+	if (!hasArea () || !frame || !frame->isVisible ())
+		return false;
+
+#if SMTG_OS_WINDOWS
+	// A child window is visible only while all its ancestors are, and the
+	// host's top-level window may be minimised without hiding anything
+	HWND parent = static_cast<HWND> (parentWindow);
+	if (!IsWindowVisible (parent) || IsIconic (GetAncestor (parent, GA_ROOT)))
+		return false;
+#endif
+	return true;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayEditor::attached (void* parent, FIDString type)
+{
+	parentWindow = parent;
+	viewHasArea = true;
+	return VST3Editor::attached (parent, type);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayEditor::removed ()
+{
+	tresult result = VST3Editor::removed ();
+	parentWindow = nullptr;
+	return result;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayEditor::onSize (ViewRect* newSize)
+{
+	tresult result = VST3Editor::onSize (newSize);
+	viewHasArea = newSize && newSize->getWidth () > 0 && newSize->getHeight () > 0;
+	if (auto* wetController = dynamic_cast<WetDelayProcessorController*> (getController ()))
+		wetController->editorResized ();
+	return result;
+}
+
 //------------------------------------------------------------------------
 // DelayButtonController Implementation (simplified - may not be needed with CSegmentButton)
 //------------------------------------------------------------------------
@@ -7,17 +7,51 @@
 #include "public.sdk/source/vst/vsteditcontroller.h"
 #include "vstgui/plugin-bindings/vst3editor.h"
 #include "vstgui/uidescription/delegationcontroller.h"
+#include "vstgui/lib/cvstguitimer.h"
 #include "wetdelaycids.h"
+#include "stageprofiler.h"
+#include <vector>
 
 namespace Yonie {
 
 // Forward declarations
 class DelayButtonController;
 
+//------------------------------------------------------------------------
+//  WetDelayEditor
+//  VST3Editor that knows whether the host is actually showing it. A
+//  hidden or minimised host window leaves the CFrame "visible", so this
+//  tracks the IPlugView size and parent window instead.
+//------------------------------------------------------------------------
+class WetDelayEditor : public VSTGUI::VST3Editor
+{
+public:
+	using VSTGUI::VST3Editor::VST3Editor;
+	
+	// False while the host has sized the view to nothing
+	bool hasArea () const { return parentWindow && viewHasArea; }
+	
+	// hasArea() and, where the platform can tell, the host window is
+	// shown and not minimised
+	bool isShowing () const;
+	
+	//--- from IPlugView -------------------------------------------------
+	Steinberg::tresult PLUGIN_API attached (void* parent, Steinberg::FIDString type) override;
+	Steinberg::tresult PLUGIN_API removed () override;
+	Steinberg::tresult PLUGIN_API onSize (Steinberg::ViewRect* newSize) override;
+
+protected:
+	void* parentWindow = nullptr;
+	bool viewHasArea = true;
+};
+
 //------------------------------------------------------------------------
 //  WetDelayProcessorController
+//  Meter values from the processor are held and handed to the editor on
+//  one fixed-rate timer, so repaints don't follow the host block rate.
 //------------------------------------------------------------------------
-class WetDelayProcessorController : public Steinberg::Vst::EditControllerEx1
+class WetDelayProcessorController : public Steinberg::Vst::EditControllerEx1,
+                                    public VSTGUI::VST3EditorDelegate
 {
 public:
 //------------------------------------------------------------------------
@@ -39,6 +73,24 @@ public:
 	Steinberg::IPlugView* PLUGIN_API createView (Steinberg::FIDString name) SMTG_OVERRIDE;
 	Steinberg::tresult PLUGIN_API setState (Steinberg::IBStream* state) SMTG_OVERRIDE;
 	Steinberg::tresult PLUGIN_API getState (Steinberg::IBStream* state) SMTG_OVERRIDE;
+	Steinberg::tresult PLUGIN_API setParamNormalized (Steinberg::Vst::ParamID tag,
+	                                                  Steinberg::Vst::ParamValue value) SMTG_OVERRIDE;
+	
+	//--- from VST3EditorDelegate ----------------------------------------
+	void didOpen (VSTGUI::VST3Editor* editor) override;
+	void willClose (VSTGUI::VST3Editor* editor) override;
+	
+#if WETDELAY_PROFILING
+	//--- from ComponentBase ---------------------------------------------
+	Steinberg::tresult PLUGIN_API notify (Steinberg::Vst::IMessage* message) SMTG_OVERRIDE;
+	
+	// Stage timings of the processor's last active run
+	const StageProfile& getStageProfile (DspStage stage) const { return stageProfiles[static_cast<int>(stage)]; }
+#endif
+	
+	// An editor was resized, possibly to nothing; starts or stops the
+	// refresh timer
+	void editorResized ();
 	
 	// Get current delay index for UI updates
 	int getCurrentDelayIndex() const { return currentDelayIndex; }
@@ -53,8 +105,31 @@ public:
 
 //------------------------------------------------------------------------
 protected:
+	static constexpr int kNumMeters = 4;  // kInputMeterL .. kOutputMeterR
+	
+	// Hand the meter values received since the last tick to the editor
+	void flushMeters ();
+	void updateRefreshTimer ();
+	bool isAnyEditorVisible () const;
+	
 	int currentDelayIndex = 0;
 	
+	// Latest meter values, pending until the next refresh tick
+	Steinberg::Vst::ParamValue meterValues[kNumMeters] = {};
+	bool meterPending[kNumMeters] = {};
+	
+	// Exists while an editor is open, runs while one of them has area
+	VSTGUI::SharedPointer<VSTGUI::CVSTGUITimer> refreshTimer;
+	std::vector<VSTGUI::VST3Editor*> openEditors;
+	int meterRefreshIndex = kDefaultMeterRefresh;
+	
+	// Reference on the shared backplate, taken by the first editor
+	bool holdsBackplate = false;
+	
+#if WETDELAY_PROFILING
+	StageProfile stageProfiles[static_cast<int>(DspStage::Count)];
+#endif
+	
 	friend class DelayButtonController;
 };
 
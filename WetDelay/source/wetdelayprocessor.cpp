@@ -4,10 +4,18 @@
 
 #include "wetdelayprocessor.h"
 #include "wetdelaycids.h"
+#include "wetdelaystate.h"
+#include "lineworker.h"
 
-#include "base/source/fstreamer.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
+#include "pluginterfaces/vst/ivstprocesscontext.h"
+#include "pluginterfaces/vst/ivstmessage.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <new>
+#include <random>
 
 using namespace Steinberg;
 
@@ -15,9 +23,14 @@ namespace Yonie {
 
 //------------------------------------------------------------------------
 // Delay times in milliseconds
-const int WetDelayProcessorProcessor::DELAY_TIMES_MS[6] = {
+const int WetDelayProcessorProcessor::DELAY_TIMES_MS[kNumDelayTimes] = {
 	20, 40, 80, 120, 220, 400
 };
+
+// Delay time multipliers
+const int WetDelayProcessorProcessor::DELAY_MULTIPLIERS[kNumDelayMultipliers] = {
+	1, 2, 5, 10, 25
+};
 //------------------------------------------------------------------------
 // WetDelayProcessorProcessor
 //------------------------------------------------------------------------
@@ -25,6 +38,11 @@ WetDelayProcessorProcessor::WetDelayProcessorProcessor ()
 {
 	//--- set the wanted controller for our processor
 	setControllerClass (kWetDelayProcessorControllerUID);
+	
+	// Fresh instances get a random seed; loading a state replaces it
+	std::random_device device;
+	noiseSeed = (static_cast<uint64>(device ()) << 32) | device ();
+	delayBuffer.setNoiseSeed (noiseSeed);
 }
 
 //------------------------------------------------------------------------
@@ -58,6 +76,7 @@ tresult PLUGIN_API WetDelayProcessorProcessor::initialize (FUnknown* context)
 tresult PLUGIN_API WetDelayProcessorProcessor::terminate ()
 {
 	// Here the Plug-in will be de-instantiated, last possibility to remove some memory!
+	LineWorker::remove (&delayBuffer);
 	
 	//---do not forget to call parent ------
 	return AudioEffect::terminate ();
@@ -69,6 +88,13 @@ tresult PLUGIN_API WetDelayProcessorProcessor::setActive (TBool state)
 	//--- called when the Plug-in is enable/disable (On/Off) -----
 	if (state)
 	{
+		// Next offline block re-aligns with the timeline
+		renderPositionValid = false;
+		
+		// Line pages the audio thread asks for are committed while active
+		if (delayBuffer.isLineCommitDeferred ())
+			LineWorker::add (&delayBuffer);
+		
 		// Reset meters when activated
 		inputPeakL = 0.0f;
 		inputPeakR = 0.0f;
@@ -79,13 +105,71 @@ tresult PLUGIN_API WetDelayProcessorProcessor::setActive (TBool state)
 		oldMeterL_Out = 0.0f;
 		oldMeterR_Out = 0.0f;
 	}
+#if WETDELAY_PROFILING
+	else
+	{
+		// Hand the stage timings of this run to the controller
+		StageProfile profiles[static_cast<int>(DspStage::Count)];
+		for (int i = 0; i < static_cast<int>(DspStage::Count); ++i)
+			delayBuffer.getProfiler ().read (static_cast<DspStage>(i), profiles[i]);
+		
+		if (IPtr<Vst::IMessage> message = owned (allocateMessage ()))
+		{
+			message->setMessageID (kStageProfileMessage);
+			message->getAttributes ()->setBinary (kStageProfileAttr, profiles, sizeof (profiles));
+			sendMessage (message);
+		}
+	}
+#endif
+	if (!state)
+	{
+		processing = false;
+		LineWorker::remove (&delayBuffer);
+	}
 	return AudioEffect::setActive (state);
 }
 
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayProcessorProcessor::setProcessing (TBool state)
+{
+	// Not concurrent with process(): the line can be copied directly, and
+	// stays current until processing starts again
+	processing = state != 0;
+	if (!state)
+		captureIdleLine ();
+	return AudioEffect::setProcessing (state);
+}
+
+//------------------------------------------------------------------------
+WetDelayProcessorProcessor::ProcessorParams WetDelayProcessorProcessor::currentParams () const
+{
+	if (pendingParamsChanged.load (std::memory_order_acquire))
+		return pendingParams.load (std::memory_order_relaxed);
+	return activeParams.load ();
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorProcessor::captureIdleLine ()
+{
+	if (!currentParams ().recall)
+	{
+		captureState.store (kCaptureIdle);
+		return;
+	}
+	delayBuffer.captureSnapshot (capturedSnapshot);
+	captureState.store (kCaptureReady);
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 {
 	//--- Read parameter changes -----------
+	//--- Take parameters published by setState -----------
+	ProcessorParams previous = params;
+	bool taken = pendingParamsChanged.exchange (false, std::memory_order_acquire);
+	if (taken)
+		params = pendingParams.load (std::memory_order_relaxed);
+	
 	if (data.inputParameterChanges)
 	{
 		int32 numParamsChanged = data.inputParameterChanges->getParameterCount ();
@@ -97,20 +181,126 @@ tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 				int32 sampleOffset;
 				int32 numPoints = paramQueue->getPointCount ();
 				
-				if (paramQueue->getParameterId () == kDelayTimeParam && numPoints > 0)
+				if (paramQueue->getParameterId () == kRecallParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+						params.recall = value > 0.5 ? 1 : 0;
+				}
+				else if (paramQueue->getParameterId () == kLineStorageParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+						params.lineStorage = value > 0.5 ? 1 : 0;
+				}
+				else if (paramQueue->getParameterId () == kQualityParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+					{
+						int quality = static_cast<int>(value * (kNumQualityModes - 1) + 0.5);
+						params.quality = static_cast<int8>(std::max (0, std::min (quality, kNumQualityModes - 1)));
+					}
+				}
+				else if (paramQueue->getParameterId () == kBitDepthParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+					{
+						int step = static_cast<int>(value * (kNumBitDepths - 1) + 0.5);
+						params.bitDepth = static_cast<int8>(kMinBitDepth + std::max (0, std::min (step, kNumBitDepths - 1)));
+					}
+				}
+				else if (paramQueue->getParameterId () == kInternalRateParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+					{
+						int rate = static_cast<int>(value * (kNumInternalRates - 1) + 0.5);
+						params.internalRate = static_cast<int8>(std::max (0, std::min (rate, kNumInternalRates - 1)));
+					}
+				}
+				else if (paramQueue->getParameterId () == kBypassParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+						params.bypass = value > 0.5 ? 1 : 0;
+				}
+				else if (paramQueue->getParameterId () == kDelayMultiplierParam && numPoints > 0)
+				{
+					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
+					{
+						int multiplier = static_cast<int>(value * (kNumDelayMultipliers - 1) + 0.5);
+						params.multiplier = static_cast<int8>(std::max (0, std::min (multiplier, kNumDelayMultipliers - 1)));
+					}
+				}
+				else if (paramQueue->getParameterId () == kDelayTimeParam && numPoints > 0)
 				{
 					// Get last parameter change
 					if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
 					{
 						// Convert normalized value (0.0-1.0) to index (0-5)
-						currentDelayIndex = static_cast<int>(value * 5.0 + 0.5);
-						if (currentDelayIndex < 0) currentDelayIndex = 0;
-						if (currentDelayIndex > 5) currentDelayIndex = 5;
+						int delayIndex = static_cast<int>(value * 5.0 + 0.5);
+						params.delayIndex = static_cast<int8>(std::max (0, std::min (delayIndex, kNumDelayTimes - 1)));
 					}
 				}
 			}
 		}
 	}
+	// Only publish what changed here; setState may have stored newer values
+	if (taken || std::memcmp (&params, &previous, sizeof (params)) != 0)
+		activeParams.store (params, std::memory_order_relaxed);
+	
+	// setupProcessing ran out of memory: nothing below has storage to use
+	if (!delayBuffer.isPrepared ())
+	{
+		for (int32 bus = 0; bus < data.numOutputs; ++bus)
+		{
+			Vst::AudioBusBuffers& output = data.outputs[bus];
+			for (int32 c = 0; c < output.numChannels; c++)
+				memset (output.channelBuffers32[c], 0, data.numSamples * sizeof(Vst::Sample32));
+			output.silenceFlags = ((uint64)1 << output.numChannels) - 1;
+		}
+		return kResultOk;
+	}
+	
+	// Leaving bypass restarts an idle engine from its cleared line
+	if (engineIdle && !params.bypass)
+		engineIdle = false;
+	
+	// A new internal rate clears the line, so it goes before any restore
+	// and before the render position is set on the new resampler grid
+	delayBuffer.setInternalRate (params.internalRate);
+	
+	//--- Swap in a delay line restored by setState -----------
+	// Its pages were filled off the audio thread; a block that cannot take
+	// them yet leaves them Ready for the next one
+	int expected = kSnapshotReady;
+	if (pendingSnapshotState.compare_exchange_strong (expected, kSnapshotApplying))
+	{
+		bool applied = delayBuffer.applyStagedSnapshot (pendingSnapshot);
+		pendingSnapshotState.store (applied ? kSnapshotEmpty : kSnapshotReady);
+	}
+	
+	//--- Keep a copy of the line for getState -----------
+	// A slice per block; getState takes the newest finished copy
+	delayBuffer.setLineCapture (params.recall != 0);
+	delayBuffer.updateCapture (CAPTURE_FRAMES_PER_BLOCK);
+	
+	if (noiseSeedChanged.exchange (false))
+		delayBuffer.setNoiseSeed (noiseSeed.load ());
+	
+	//--- Offline renders follow the project timeline -----------
+	// The engine is aligned to projectTimeSamples so that a render split
+	// into chunks (each started with pre-roll) matches a single pass.
+	// A jump mid-render starts a new chunk from a cleared line. An idle
+	// engine is aligned again when it restarts.
+	if (processSetup.processMode == Vst::kOffline && data.processContext && !engineIdle)
+	{
+		Vst::TSamples position = data.processContext->projectTimeSamples;
+		if (!renderPositionValid || position != nextRenderPosition)
+		{
+			if (renderPositionValid)
+				delayBuffer.reset ();
+			delayBuffer.setRenderPosition (position);
+		}
+		nextRenderPosition = position + data.numSamples;
+		renderPositionValid = true;
+	}
 	
 	//--- Process audio -----------
 	if (data.numInputs == 0 || data.numOutputs == 0)
@@ -122,11 +312,12 @@ tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 		Vst::AudioBusBuffers& input = data.inputs[0];
 		Vst::AudioBusBuffers& output = data.outputs[0];
 		
-		// Ensure we have stereo
-		if (input.numChannels >= 2 && output.numChannels >= 2)
+		// Stereo output; a mono input feeds both channels, which the delay
+		// buffer then processes once
+		if (input.numChannels >= 1 && output.numChannels >= 2)
 		{
 			float* inputL = input.channelBuffers32[0];
-			float* inputR = input.channelBuffers32[1];
+			float* inputR = input.numChannels >= 2 ? input.channelBuffers32[1] : inputL;
 			float* outputL = output.channelBuffers32[0];
 			float* outputR = output.channelBuffers32[1];
 			
@@ -138,9 +329,14 @@ tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 			}
 			
 			// Process delay (100% wet)
-			int delayMs = DELAY_TIMES_MS[currentDelayIndex];
-			delayBuffer.processStereo(inputL, outputL, inputR, outputR,
-			                          data.numSamples, delayMs);
+			int delayMs = delayTimeMs (params);
+			delayBuffer.setQuality (selectQuality ());
+			delayBuffer.setBitDepth (params.bitDepth);
+			bool passThrough = false;
+			if (params.bypass || bypassMix > 0.0f)
+				passThrough = processBypass (inputL, outputL, inputR, outputR, data.numSamples, delayMs);
+			else
+				runEngine (inputL, outputL, inputR, outputR, data.numSamples, delayMs);
 			
 			// Measure output levels
 			for (int32 i = 0; i < data.numSamples; i++)
@@ -176,12 +372,17 @@ tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 				sendMeter(kOutputMeterR, outR, oldMeterR_Out);
 			}
 			
-			// Output is not silent
-			output.silenceFlags = 0;
+			// A pass-through block is exactly as silent as its input; a mono
+			// input feeds both outputs
+			if (passThrough)
+				output.silenceFlags = input.numChannels >= 2 ? (input.silenceFlags & 3)
+				                                             : ((input.silenceFlags & 1) ? 3 : 0);
+			else
+				output.silenceFlags = 0;
 		}
 		else
 		{
-			// Clear output if not stereo
+			// Clear output if there is no stereo output
 			for (int32 c = 0; c < output.numChannels; c++)
 			{
 				memset(output.channelBuffers32[c], 0,
@@ -194,12 +395,217 @@ tresult PLUGIN_API WetDelayProcessorProcessor::process (Vst::ProcessData& data)
 	return kResultOk;
 }
 
+//------------------------------------------------------------------------
+int WetDelayProcessorProcessor::delayTimeMs (const ProcessorParams& values)
+{
+	return DELAY_TIMES_MS[std::max (0, std::min (static_cast<int>(values.delayIndex), kNumDelayTimes - 1))]
+	     * DELAY_MULTIPLIERS[std::max (0, std::min (static_cast<int>(values.multiplier), kNumDelayMultipliers - 1))];
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorProcessor::runEngine (const float* inputL, float* outputL,
+                                            const float* inputR, float* outputR,
+                                            int32 numSamples, int delayMs)
+{
+	if (params.quality == kQualityAuto && processSetup.processMode != Vst::kOffline)
+	{
+		auto start = std::chrono::steady_clock::now ();
+		delayBuffer.processStereo (inputL, outputL, inputR, outputR, numSamples, delayMs);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+		updateAutoQuality (elapsed.count (), numSamples);
+	}
+	else
+	{
+		delayBuffer.processStereo (inputL, outputL, inputR, outputR, numSamples, delayMs);
+	}
+}
+
+//------------------------------------------------------------------------
+bool WetDelayProcessorProcessor::processBypass (const float* inputL, float* outputL,
+                                                const float* inputR, float* outputR,
+                                                int32 numSamples, int delayMs)
+{
+	// Tail played out: the engine costs nothing until bypass is left
+	if (engineIdle)
+	{
+		if (outputL != inputL)
+			std::copy (inputL, inputL + numSamples, outputL);
+		if (outputR != inputR)
+			std::copy (inputR, inputR + numSamples, outputR);
+		return true;
+	}
+	
+	bool mono = (inputL == inputR);
+	float target = params.bypass ? 1.0f : 0.0f;
+	float step = static_cast<float>(1000.0 / (BYPASS_RAMP_MS * processSetup.sampleRate));
+	auto advance = [&] (float mix) {
+		return target > mix ? std::min (target, mix + step) : std::max (target, mix - step);
+	};
+	
+	int32 chunk = std::max<int32> (1, bypassScratchSize);
+	float* dryL = bypassScratch.data ();
+	float* dryR = mono ? dryL : dryL + chunk;
+	float* fadedL = dryL + 2 * chunk;
+	float* fadedR = mono ? fadedL : fadedL + chunk;
+	
+	for (int32 offset = 0; offset < numSamples; offset += chunk)
+	{
+		int32 count = std::min (chunk, numSamples - offset);
+		std::copy (inputL + offset, inputL + offset + count, dryL);
+		if (!mono)
+			std::copy (inputR + offset, inputR + offset + count, dryR);
+		
+		// The delay gets the input faded by the same ramp the dry signal
+		// comes in with; identical channels stay identical
+		float mix = bypassMix;
+		for (int32 i = 0; i < count; ++i)
+		{
+			mix = advance (mix);
+			fadedL[i] = dryL[i] * (1.0f - mix);
+			if (!mono)
+				fadedR[i] = dryR[i] * (1.0f - mix);
+		}
+		
+		runEngine (fadedL, outputL + offset, fadedR, outputR + offset, count, delayMs);
+		
+		mix = bypassMix;
+		for (int32 i = 0; i < count; ++i)
+		{
+			mix = advance (mix);
+			outputL[offset + i] += dryL[i] * mix;
+			outputR[offset + i] += dryR[i] * mix;
+			bypassSilentSamples = (mix >= 1.0f) ? bypassSilentSamples + 1 : 0;
+		}
+		bypassMix = mix;
+	}
+	
+	// Everything that entered the line before the fade has come out
+	int64 tailSamples = static_cast<int64>((delayMs + BYPASS_SETTLE_MS) * processSetup.sampleRate / 1000.0);
+	if (params.bypass && bypassMix >= 1.0f && bypassSilentSamples >= tailSamples)
+	{
+		delayBuffer.reset ();
+		engineIdle = true;
+		renderPositionValid = false;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------
+DelayBuffer::Quality WetDelayProcessorProcessor::selectQuality () const
+{
+	switch (params.quality)
+	{
+		case kQualityEco:
+			return DelayBuffer::Quality::Eco;
+		case kQualityHigh:
+			return DelayBuffer::Quality::High;
+		case kQualityAuto:
+			// Offline renders have no deadline
+			return processSetup.processMode == Vst::kOffline ? DelayBuffer::Quality::High : autoQuality;
+		default:
+			return DelayBuffer::Quality::Standard;
+	}
+}
+
+//------------------------------------------------------------------------
+void WetDelayProcessorProcessor::updateAutoQuality (double elapsedSeconds, int32 numSamples)
+{
+	double budget = numSamples / processSetup.sampleRate;
+	double load = elapsedSeconds / budget;
+	
+	if (load > AUTO_STEP_DOWN_LOAD)
+	{
+		if (autoQuality == DelayBuffer::Quality::High)
+			autoQuality = DelayBuffer::Quality::Standard;
+		else
+			autoQuality = DelayBuffer::Quality::Eco;
+		autoHeadroomSamples = 0;
+	}
+	else if (load < AUTO_STEP_UP_LOAD)
+	{
+		autoHeadroomSamples += numSamples;
+		if (autoHeadroomSamples >= static_cast<int64>(AUTO_STEP_UP_SECONDS * processSetup.sampleRate))
+		{
+			if (autoQuality == DelayBuffer::Quality::Eco)
+				autoQuality = DelayBuffer::Quality::Standard;
+			else
+				autoQuality = DelayBuffer::Quality::High;
+			autoHeadroomSamples = 0;
+		}
+	}
+	else
+	{
+		autoHeadroomSamples = 0;
+	}
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API WetDelayProcessorProcessor::setBusArrangements (Vst::SpeakerArrangement* inputs, int32 numIns,
+                                                                   Vst::SpeakerArrangement* outputs, int32 numOuts)
+{
+	if (numIns == 1 && numOuts == 1 && outputs[0] == Vst::SpeakerArr::kStereo
+	    && (inputs[0] == Vst::SpeakerArr::kStereo || inputs[0] == Vst::SpeakerArr::kMono))
+	{
+		if (Vst::AudioBus* bus = getAudioInput (0))
+		{
+			bus->setArrangement (inputs[0]);
+			bus->setName (inputs[0] == Vst::SpeakerArr::kMono ? STR16 ("Mono In") : STR16 ("Stereo In"));
+		}
+		return kResultTrue;
+	}
+	return kResultFalse;
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API WetDelayProcessorProcessor::setupProcessing (Vst::ProcessSetup& newSetup)
 {
 	//--- called before any processing ----
 	// Initialize delay buffer with max delay time
-	delayBuffer.prepare(newSetup.sampleRate, 400);  // 400ms max
+	// With session recall on, re-activation at the same rate keeps the line
+	// Not concurrent with process(), but setState may have run since the last block
+	ProcessorParams current = currentParams ();
+	delayBuffer.setLineFormat (current.lineStorage ? DelayBuffer::LineFormat::Packed12
+	                                               : DelayBuffer::LineFormat::Float32);
+	
+	// In real time the audio thread only asks for line pages, and
+	// LineWorker commits them while active; bounces commit them in process()
+	delayBuffer.setDeferredLineCommit (newSetup.processMode != Vst::kOffline);
+	
+	// Bounces get larger sub-blocks; no need for scratch beyond the host's block size
+	int chunkSize = newSetup.processMode == Vst::kOffline ? DelayBuffer::OFFLINE_CHUNK_SIZE
+	                                                     : DelayBuffer::REALTIME_CHUNK_SIZE;
+	if (newSetup.maxSamplesPerBlock > 0)
+		chunkSize = std::min (chunkSize, static_cast<int>(newSetup.maxSamplesPerBlock));
+	delayBuffer.setChunkSize (chunkSize);
+	
+	// A copy taken before may be of a line prepare() has since cleared
+	captureState.store (kCaptureIdle);
+	
+	// Out of memory leaves the engine unprepared; process() then outputs
+	// silence until a later setupProcessing succeeds
+	try
+	{
+		// Bypass keeps a copy of the dry block, in host-sized pieces
+		bypassScratchSize = std::max<int32> (1, newSetup.maxSamplesPerBlock);
+		bypassScratch.assign (static_cast<size_t>(bypassScratchSize) * 4, 0.0f);
+		if (!(current.recall && delayBuffer.isPreparedFor(newSetup.sampleRate, MAX_DELAY_MS)))
+			delayBuffer.prepare(newSetup.sampleRate, MAX_DELAY_MS);
+		
+		// The current delay starts with its pages in place
+		delayBuffer.growLineFor (delayTimeMs (current));
+	}
+	catch (const std::bad_alloc&)
+	{
+		bypassScratch.clear ();
+		bypassScratchSize = 0;
+		return kOutOfMemory;
+	}
+	
+	// prepare() dropped anything staged; a restore still waiting is staged
+	// again for the new setup
+	int expected = kSnapshotReady;
+	if (pendingSnapshotState.compare_exchange_strong (expected, kSnapshotWriting))
+		pendingSnapshotState.store (delayBuffer.stageSnapshot (pendingSnapshot) ? kSnapshotReady : kSnapshotEmpty);
 	
 	return AudioEffect::setupProcessing (newSetup);
 }
@@ -222,14 +628,60 @@ tresult PLUGIN_API WetDelayProcessorProcessor::canProcessSampleSize (int32 symbo
 tresult PLUGIN_API WetDelayProcessorProcessor::setState (IBStream* state)
 {
 	// called when we load a preset, the model has to be reloaded
-	IBStreamer streamer (state, kLittleEndian);
+	// Nothing is applied unless the chunk parses, checksums and validates
+	ProcessorParams current = currentParams ();
+	WetDelayStateData data;
+	data.delayIndex = current.delayIndex;
+	data.recall = current.recall;
+	data.lineStorage = current.lineStorage;
+	data.quality = current.quality;
+	data.delayMultiplier = current.multiplier;
+	data.bitDepth = current.bitDepth;
+	data.internalRate = current.internalRate;
+	data.bypass = current.bypass;
+	data.noiseSeed = noiseSeed.load ();
 	
-	int32 savedDelayIndex = 0;
-	if (streamer.readInt32(savedDelayIndex) == kResultTrue)
+	// Take ownership of the pending snapshot unless process() is applying it;
+	// in that case the stored line is skipped
+	int expected = kSnapshotEmpty;
+	bool ownsSnapshot = pendingSnapshotState.compare_exchange_strong (expected, kSnapshotWriting);
+	if (!ownsSnapshot && expected == kSnapshotReady)
+		ownsSnapshot = pendingSnapshotState.compare_exchange_strong (expected, kSnapshotWriting);
+	if (ownsSnapshot)
+		data.snapshot = &pendingSnapshot;
+	
+	bool valid = readWetDelayState (state, data);
+	
+	// The line is laid out in spare pages here, not on the audio thread;
+	// before the engine is prepared, setupProcessing does it
+	if (ownsSnapshot)
 	{
-		currentDelayIndex = savedDelayIndex;
+		bool staged = valid && data.snapshotLoaded
+		              && (!delayBuffer.isPrepared () || delayBuffer.stageSnapshot (pendingSnapshot));
+		pendingSnapshotState.store (staged ? kSnapshotReady : kSnapshotEmpty);
 	}
+	if (!valid)
+		return kResultFalse;
+	
+	// Values are range-checked by readWetDelayState; publish them as one unit
+	ProcessorParams loaded = DEFAULT_PARAMS;
+	loaded.delayIndex = static_cast<int8>(data.delayIndex);
+	loaded.recall = static_cast<int8>(data.recall);
+	loaded.lineStorage = static_cast<int8>(data.lineStorage);
+	loaded.quality = static_cast<int8>(data.quality);
+	loaded.multiplier = static_cast<int8>(data.delayMultiplier);
+	loaded.bitDepth = static_cast<int8>(data.bitDepth);
+	loaded.internalRate = static_cast<int8>(data.internalRate);
+	loaded.bypass = static_cast<int8>(data.bypass);
+	pendingParams.store (loaded, std::memory_order_relaxed);
+	activeParams.store (loaded, std::memory_order_relaxed);
+	pendingParamsChanged.store (true, std::memory_order_release);
 	
+	if (data.noiseSeed != noiseSeed.load ())
+	{
+		noiseSeed = data.noiseSeed;
+		noiseSeedChanged = true;
+	}
 	return kResultOk;
 }
 
@@ -237,11 +689,48 @@ tresult PLUGIN_API WetDelayProcessorProcessor::setState (IBStream* state)
 tresult PLUGIN_API WetDelayProcessorProcessor::getState (IBStream* state)
 {
 	// here we need to save the model
-	IBStreamer streamer (state, kLittleEndian);
+	ProcessorParams current = currentParams ();
+	WetDelayStateData data;
+	data.delayIndex = current.delayIndex;
+	data.recall = current.recall;
+	data.lineStorage = current.lineStorage;
+	data.quality = current.quality;
+	data.delayMultiplier = current.multiplier;
+	data.bitDepth = current.bitDepth;
+	data.internalRate = current.internalRate;
+	data.bypass = current.bypass;
+	data.noiseSeed = noiseSeed.load ();
 	
-	streamer.writeInt32(currentDelayIndex);
-
-	return kResultOk;
+	// Never waits for process(): a restore not yet applied is saved as
+	// loaded, else the newest rolling capture (see CaptureState) or, while
+	// not processing, the line itself
+	if (current.recall)
+	{
+		int expected = kSnapshotReady;
+		if (pendingSnapshotState.compare_exchange_strong (expected, kSnapshotWriting))
+		{
+			data.snapshot = &pendingSnapshot;
+			bool written = writeWetDelayState (state, data);
+			pendingSnapshotState.store (kSnapshotReady);
+			return written ? kResultOk : kResultFalse;
+		}
+		
+		if (processing.load ())
+		{
+			captureState.store (kCaptureIdle);
+			if (delayBuffer.readCapture (capturedSnapshot))
+				data.snapshot = &capturedSnapshot;
+		}
+		else
+		{
+			if (captureState.load () != kCaptureReady)
+				captureIdleLine ();
+			if (captureState.load () == kCaptureReady)
+				data.snapshot = &capturedSnapshot;
+		}
+	}
+	
+	return writeWetDelayState (state, data) ? kResultOk : kResultFalse;
 }
 
 //------------------------------------------------------------------------
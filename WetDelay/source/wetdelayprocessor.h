@@ -8,6 +8,7 @@
 #include "delaybuffer.h"
 #include "wetdelaycids.h"
 #include <atomic>
+#include <vector>
 
 namespace Yonie {
 
@@ -38,6 +39,13 @@ public:
 	/** Switch the Plug-in on/off */
 	Steinberg::tresult PLUGIN_API setActive (Steinberg::TBool state) SMTG_OVERRIDE;
 
+	/** Start/stop of process() calls */
+	Steinberg::tresult PLUGIN_API setProcessing (Steinberg::TBool state) SMTG_OVERRIDE;
+
+	/** Stereo output with a stereo or mono input */
+	Steinberg::tresult PLUGIN_API setBusArrangements (Steinberg::Vst::SpeakerArrangement* inputs, Steinberg::int32 numIns,
+	                                                  Steinberg::Vst::SpeakerArrangement* outputs, Steinberg::int32 numOuts) SMTG_OVERRIDE;
+
 	/** Will be called before any process call */
 	Steinberg::tresult PLUGIN_API setupProcessing (Steinberg::Vst::ProcessSetup& newSetup) SMTG_OVERRIDE;
 	
@@ -56,11 +64,119 @@ protected:
 	// Delay buffer
 	DelayBuffer delayBuffer;
 	
-	// Current delay time index (0-5)
-	int currentDelayIndex = 0;
+	// Plain parameter values, small enough for a lock-free atomic
+	struct ProcessorParams
+	{
+		Steinberg::int8 delayIndex;  // 0-5
+		Steinberg::int8 recall;      // Keep the delay line across re-activation and store it in the state
+		Steinberg::int8 lineStorage; // 0 = float, 1 = 12-bit packed; takes effect in setupProcessing
+		Steinberg::int8 quality;     // QualityModes
+		Steinberg::int8 multiplier;  // 0-4, index into DELAY_MULTIPLIERS
+		Steinberg::int8 bitDepth;    // 8-16 bits
+		Steinberg::int8 internalRate; // 0-3, index into DelayBuffer::INTERNAL_RATES
+		Steinberg::int8 bypass;      // Host bypass; see processBypass
+	};
+	static constexpr ProcessorParams DEFAULT_PARAMS = {0, 0, 0, kQualityStandard, 0, kDefaultBitDepth, kDefaultInternalRate, 0};
+	static_assert (std::atomic<ProcessorParams>::is_always_lock_free, "parameter handoff must be lock-free");
+	
+	// Audio thread copy; process() reads only this
+	ProcessorParams params = DEFAULT_PARAMS;
+	
+	// setState publishes into pendingParams and raises the flag; process()
+	// takes them at the next block start. activeParams holds the values
+	// process() last used, stored only when they change, so a block that
+	// has not taken setState's values yet does not write its old ones back.
+	std::atomic<ProcessorParams> pendingParams{DEFAULT_PARAMS};
+	std::atomic<bool> pendingParamsChanged{false};
+	std::atomic<ProcessorParams> activeParams{DEFAULT_PARAMS};
+	
+	// For getState/setState/setupProcessing: values from setState that
+	// process() has not taken yet, else activeParams
+	ProcessorParams currentParams () const;
+	
+	// In auto quality mode the tier follows the measured cost of each
+	// block against its real-time budget
+	DelayBuffer::Quality autoQuality = DelayBuffer::Quality::High;
+	Steinberg::int64 autoHeadroomSamples = 0;
+	
+	// Auto mode thresholds, as a fraction of the block's real-time budget.
+	// Step down at once on a slow block; step up after sustained headroom.
+	static constexpr double AUTO_STEP_DOWN_LOAD = 0.5;
+	static constexpr double AUTO_STEP_UP_LOAD = 0.15;
+	static constexpr double AUTO_STEP_UP_SECONDS = 2.0;
+	
+	// Pick the tier for the next block / feed back the time it took
+	DelayBuffer::Quality selectQuality () const;
+	void updateAutoQuality (double elapsedSeconds, Steinberg::int32 numSamples);
+	
+	// Delay time for the selected time and multiplier
+	static int delayTimeMs (const ProcessorParams& values);
+	
+	// processStereo, timed for auto quality where that applies
+	void runEngine (const float* inputL, float* outputL, const float* inputR, float* outputR,
+	                Steinberg::int32 numSamples, int delayMs);
+	
+	// Host bypass. Entering it fades the delay input out while the dry input
+	// fades in over BYPASS_RAMP_MS; the tail already in the line keeps
+	// playing. Once it has played out the line is cleared and processStereo
+	// is not called at all until bypass is left, which runs the same ramp
+	// the other way. Returns true if the block was a plain pass-through.
+	bool processBypass (const float* inputL, float* outputL, const float* inputR, float* outputR,
+	                    Steinberg::int32 numSamples, int delayMs);
+	
+	static constexpr double BYPASS_RAMP_MS = 5.0;
+	static constexpr double BYPASS_SETTLE_MS = 20.0;  // filters after the last delayed sample
+	float bypassMix = 0.0f;                  // 0 = delay, 1 = dry pass-through
+	Steinberg::int64 bypassSilentSamples = 0; // host samples of silent delay input
+	bool engineIdle = false;                 // tail played out, processStereo not called
+	
+	// Dry and faded input, L and R, for up to maxSamplesPerBlock each (the
+	// host may process in place); sized in setupProcessing
+	std::vector<float> bypassScratch;
+	Steinberg::int32 bypassScratchSize = 0;
+	
+	// Snapshot handoff from setState to process(). setState only writes the
+	// snapshot while it owns it (Writing) and stages its line in the delay
+	// buffer's spare pages; process() swaps Ready snapshots in. Before the
+	// engine is prepared, setupProcessing stages it.
+	enum SnapshotState { kSnapshotEmpty, kSnapshotWriting, kSnapshotReady, kSnapshotApplying };
+	DelayLineSnapshot pendingSnapshot;
+	std::atomic<int> pendingSnapshotState{kSnapshotEmpty};
+	
+	// Line copy for getState, owned by the calling thread. While processing,
+	// process() keeps a rolling capture in the delay buffer, restarted about
+	// once a second, and getState reads the newest finished one; none is
+	// there yet right after processing starts or the line is cleared, and
+	// the state is then saved without the line. While not processing, the copy taken when
+	// processing stopped (Ready) is current.
+	enum CaptureState { kCaptureIdle, kCaptureReady };
+	DelayLineSnapshot capturedSnapshot;
+	std::atomic<int> captureState{kCaptureIdle};
+	std::atomic<bool> processing{false};
+	static constexpr int CAPTURE_FRAMES_PER_BLOCK = 16384;  // line frames copied per block, beyond the block's own
+	
+	// Copy the line into capturedSnapshot while process() is not running
+	void captureIdleLine ();
+	
+	// Dither/noise seed, stored with the state so renders are repeatable.
+	// setState publishes a new seed; process() applies it at block start.
+	std::atomic<Steinberg::uint64> noiseSeed{0};
+	std::atomic<bool> noiseSeedChanged{false};
+	
+	// Offline renders follow the project timeline (see process())
+	Steinberg::int64 nextRenderPosition = 0;
+	bool renderPositionValid = false;
+	
+	// Maximum delay the buffer is prepared for (400 ms x 25). Only address
+	// space is reserved for it; pages follow the delay in use, committed by
+	// LineWorker in real time.
+	static constexpr int MAX_DELAY_MS = 10000;
 	
 	// Delay time values in milliseconds
-	static const int DELAY_TIMES_MS[6];
+	static const int DELAY_TIMES_MS[kNumDelayTimes];
+	
+	// Factors applied to the selected delay time
+	static const int DELAY_MULTIPLIERS[kNumDelayMultipliers];
 	
 	// Peak level meters (thread-safe)
 	std::atomic<float> inputPeakL{0.0f};
@@ -0,0 +1,604 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#include "wetdelaystate.h"
+#include "wetdelaycids.h"
+#include <cstring>
+
+using namespace Steinberg;
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// FNV-1a (32-bit)
+//------------------------------------------------------------------------
+static constexpr uint32 kFnvOffset = 2166136261u;
+static constexpr uint32 kFnvPrime = 16777619u;
+
+static uint32 hashBytes(uint32 hash, const void* data, uint32 size)
+{
+    const uint8* bytes = static_cast<const uint8*>(data);
+    for (uint32 i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+// Hash a word in little-endian byte order regardless of host endianness
+static uint32 hashWord(uint32 hash, uint32 value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------
+// StateWriter Implementation
+//------------------------------------------------------------------------
+StateWriter::StateWriter(IBStream* stream)
+: streamer(stream, kLittleEndian)
+, checksum(kFnvOffset)
+, ok(stream != nullptr)
+{
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::begin()
+{
+    // Magic is not part of the checksum
+    ok = ok && streamer.writeInt32u(StateFormat::kMagic);
+    return writeWord(StateFormat::kVersion);
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeInt32Field(uint32 id, int32 value)
+{
+    return beginField(id, sizeof(int32)) && writeInt32(value);
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::beginField(uint32 id, uint32 length)
+{
+    return writeWord(id) && writeWord(length);
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeInt32(int32 value)
+{
+    return writeWord(static_cast<uint32>(value));
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeFloat(float value)
+{
+    uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return writeWord(bits);
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeDouble(double value)
+{
+    uint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return writeWord(static_cast<uint32>(bits)) && writeWord(static_cast<uint32>(bits >> 32));
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeBytes(const void* data, uint32 size)
+{
+    if (!ok)
+        return false;
+    checksum = hashBytes(checksum, data, size);
+    ok = streamer.writeRaw(data, size) == static_cast<TSize>(size);
+    return ok;
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::finish()
+{
+    uint32 sum = checksum;
+    ok = ok && streamer.writeInt32u(StateFormat::kFieldEnd)
+            && streamer.writeInt32u(sizeof(uint32))
+            && streamer.writeInt32u(sum);
+    return ok;
+}
+
+//------------------------------------------------------------------------
+bool StateWriter::writeWord(uint32 value)
+{
+    if (!ok)
+        return false;
+    checksum = hashWord(checksum, value);
+    ok = streamer.writeInt32u(value);
+    return ok;
+}
+
+//------------------------------------------------------------------------
+// StateReader Implementation
+//------------------------------------------------------------------------
+StateReader::StateReader(IBStream* stream)
+: streamer(stream, kLittleEndian)
+, checksum(kFnvOffset)
+, fieldRemaining(0)
+, reachedEnd(false)
+, ok(stream != nullptr)
+{
+}
+
+//------------------------------------------------------------------------
+StateReader::Format StateReader::open(int32& legacyValue)
+{
+    uint32 first = 0;
+    if (!ok || !streamer.readInt32u(first))
+        return Format::Invalid;
+
+    if (first != StateFormat::kMagic)
+    {
+        legacyValue = static_cast<int32>(first);
+        return Format::Legacy;
+    }
+
+    // Newer major layouts are not readable; fields within a version are
+    // forward compatible by design
+    uint32 version = 0;
+    if (!readHeaderWord(version) || version == 0 || version > StateFormat::kVersion)
+        return Format::Invalid;
+
+    return Format::Versioned;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::nextField(uint32& id, uint32& length)
+{
+    if (!ok || reachedEnd)
+        return false;
+
+    // Skip whatever the caller did not consume
+    if (fieldRemaining > 0 && !skip(fieldRemaining))
+        return false;
+
+    // The end field header is not covered by the checksum
+    uint32 fieldId = 0;
+    if (!streamer.readInt32u(fieldId))
+        return ok = false;
+
+    if (fieldId == StateFormat::kFieldEnd)
+    {
+        reachedEnd = true;
+        return false;
+    }
+
+    checksum = hashWord(checksum, fieldId);
+    if (!readHeaderWord(length))
+        return false;
+
+    id = fieldId;
+    fieldRemaining = length;
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readInt32(int32& value)
+{
+    uint32 word = 0;
+    if (!readWord(word))
+        return false;
+    value = static_cast<int32>(word);
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readFloat(float& value)
+{
+    uint32 word = 0;
+    if (!readWord(word))
+        return false;
+    std::memcpy(&value, &word, sizeof(value));
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readDouble(double& value)
+{
+    uint32 lo = 0, hi = 0;
+    if (!readWord(lo) || !readWord(hi))
+        return false;
+    uint64 bits = (static_cast<uint64>(hi) << 32) | lo;
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readBytes(void* data, uint32 size)
+{
+    if (!ok || size > fieldRemaining)
+        return ok = false;
+    if (streamer.readRaw(data, size) != static_cast<TSize>(size))
+        return ok = false;
+    checksum = hashBytes(checksum, data, size);
+    fieldRemaining -= size;
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::finish()
+{
+    if (!ok)
+        return false;
+
+    // Drain any fields the caller did not iterate
+    uint32 id, length;
+    while (nextField(id, length)) {}
+    if (!ok || !reachedEnd)
+        return false;
+
+    uint32 endLength = 0;
+    uint32 stored = 0;
+    if (!streamer.readInt32u(endLength) || endLength != sizeof(uint32) || !streamer.readInt32u(stored))
+        return false;
+
+    return stored == checksum;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readWord(uint32& value)
+{
+    // Payload reads may not run past the declared field length
+    if (fieldRemaining < sizeof(uint32))
+        return ok = false;
+    if (!readHeaderWord(value))
+        return false;
+    fieldRemaining -= sizeof(uint32);
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::readHeaderWord(uint32& value)
+{
+    if (!ok || !streamer.readInt32u(value))
+        return ok = false;
+    checksum = hashWord(checksum, value);
+    return true;
+}
+
+//------------------------------------------------------------------------
+bool StateReader::skip(uint32 size)
+{
+    // Unknown fields still count towards the checksum, so read them through
+    // a small stack buffer rather than seeking
+    uint8 scratch[256];
+    while (size > 0)
+    {
+        uint32 chunk = size < sizeof(scratch) ? size : static_cast<uint32>(sizeof(scratch));
+        if (!readBytes(scratch, chunk))
+            return false;
+        size -= chunk;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+// Delay line snapshot field
+//
+//   uint32 sample format (kSnapshotFloat32 / kSnapshotPacked12)
+//   float64 host sample rate
+//   uint32 filter count, then { float z1, float x1 } per filter
+//   uint32 resampler count, then { float64 phase, float last } per resampler
+//   uint32 line length in frames, then either left and right float
+//          samples or 3 bytes per packed 12-bit stereo frame
+//   uint64 noise position, uint32 carry count, float carryL[2], carryR[2]
+//   { float prev1, float prev2 } per resampler (cubic history, optional)
+//   float64 internal sample rate (optional, 24 kHz if absent)
+//
+// Line samples are written raw; all supported targets are little endian.
+//------------------------------------------------------------------------
+enum SnapshotFormat : uint32
+{
+    kSnapshotFloat32 = 0,
+    kSnapshotPacked12 = 1
+};
+
+static uint32 snapshotLineBytes(bool packed, uint32 frames)
+{
+    return packed ? frames * 3 : frames * 2 * static_cast<uint32>(sizeof(float));
+}
+
+static uint32 snapshotFieldLength(const DelayLineSnapshot& snapshot)
+{
+    uint32 lineBytes = snapshotLineBytes(snapshot.packed, static_cast<uint32>(snapshot.getNumFrames()));
+    return 4 + 8
+         + 4 + DelayLineSnapshot::kNumFilters * 8
+         + 4 + DelayLineSnapshot::kNumResamplers * 12
+         + 4 + lineBytes
+         + 8 + 4 + 2 * DelayLineSnapshot::kMaxCarry * 4
+         + DelayLineSnapshot::kNumResamplers * 8
+         + 8;
+}
+
+//------------------------------------------------------------------------
+static bool writeSnapshot(StateWriter& writer, const DelayLineSnapshot& snapshot)
+{
+    if (!writer.beginField(StateFormat::kFieldDelaySnapshot, snapshotFieldLength(snapshot))
+        || !writer.writeInt32(snapshot.packed ? kSnapshotPacked12 : kSnapshotFloat32)
+        || !writer.writeDouble(snapshot.hostSampleRate)
+        || !writer.writeInt32(DelayLineSnapshot::kNumFilters))
+        return false;
+    
+    for (int i = 0; i < DelayLineSnapshot::kNumFilters; ++i)
+    {
+        if (!writer.writeFloat(snapshot.filterZ1[i]) || !writer.writeFloat(snapshot.filterX1[i]))
+            return false;
+    }
+    
+    if (!writer.writeInt32(DelayLineSnapshot::kNumResamplers))
+        return false;
+    for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+    {
+        if (!writer.writeDouble(snapshot.resamplerPhase[i]) || !writer.writeFloat(snapshot.resamplerLast[i]))
+            return false;
+    }
+    
+    uint32 length = static_cast<uint32>(snapshot.getNumFrames());
+    if (!writer.writeInt32(static_cast<int32>(length)))
+        return false;
+    if (snapshot.packed)
+    {
+        if (!writer.writeBytes(snapshot.packedLine.data(), snapshotLineBytes(true, length)))
+            return false;
+    }
+    else
+    {
+        uint32 lineBytes = length * sizeof(float);
+        if (!writer.writeBytes(snapshot.lineL.data(), lineBytes)
+            || !writer.writeBytes(snapshot.lineR.data(), lineBytes))
+            return false;
+    }
+    
+    if (!writer.writeInt32(static_cast<int32>(snapshot.noisePosition))
+        || !writer.writeInt32(static_cast<int32>(snapshot.noisePosition >> 32))
+        || !writer.writeInt32(snapshot.carryCount))
+        return false;
+    for (int i = 0; i < DelayLineSnapshot::kMaxCarry; ++i)
+    {
+        if (!writer.writeFloat(snapshot.carryL[i]) || !writer.writeFloat(snapshot.carryR[i]))
+            return false;
+    }
+    for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+    {
+        if (!writer.writeFloat(snapshot.resamplerPrev1[i]) || !writer.writeFloat(snapshot.resamplerPrev2[i]))
+            return false;
+    }
+    return writer.writeDouble(snapshot.internalSampleRate);
+}
+
+//------------------------------------------------------------------------
+static bool readSnapshot(StateReader& reader, DelayLineSnapshot& snapshot)
+{
+    int32 format = 0, filterCount = 0, resamplerCount = 0, length = 0;
+    if (!reader.readInt32(format) || (format != kSnapshotFloat32 && format != kSnapshotPacked12)
+        || !reader.readDouble(snapshot.hostSampleRate)
+        || !reader.readInt32(filterCount) || filterCount != DelayLineSnapshot::kNumFilters)
+        return false;
+    
+    for (int i = 0; i < DelayLineSnapshot::kNumFilters; ++i)
+    {
+        if (!reader.readFloat(snapshot.filterZ1[i]) || !reader.readFloat(snapshot.filterX1[i]))
+            return false;
+    }
+    
+    if (!reader.readInt32(resamplerCount) || resamplerCount != DelayLineSnapshot::kNumResamplers)
+        return false;
+    for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+    {
+        if (!reader.readDouble(snapshot.resamplerPhase[i]) || !reader.readFloat(snapshot.resamplerLast[i]))
+            return false;
+    }
+    
+    // Bound the line before sizing for it; the checksum is only known at the end
+    if (!reader.readInt32(length) || length < 0
+        || static_cast<uint32>(length) > StateFormat::kMaxSnapshotSamples
+        || reader.remaining() < snapshotLineBytes(format == kSnapshotPacked12, static_cast<uint32>(length)))
+        return false;
+    
+    snapshot.packed = (format == kSnapshotPacked12);
+    if (snapshot.packed)
+    {
+        snapshot.packedLine.resize(static_cast<size_t>(length) * 3);
+        snapshot.lineL.clear();
+        snapshot.lineR.clear();
+        if (!reader.readBytes(snapshot.packedLine.data(), snapshotLineBytes(true, static_cast<uint32>(length))))
+            return false;
+    }
+    else
+    {
+        uint32 lineBytes = static_cast<uint32>(length) * sizeof(float);
+        snapshot.lineL.resize(length);
+        snapshot.lineR.resize(length);
+        snapshot.packedLine.clear();
+        if (!reader.readBytes(snapshot.lineL.data(), lineBytes)
+            || !reader.readBytes(snapshot.lineR.data(), lineBytes))
+            return false;
+    }
+    
+    int32 noiseLo = 0, noiseHi = 0;
+    if (!reader.readInt32(noiseLo) || !reader.readInt32(noiseHi) || !reader.readInt32(snapshot.carryCount)
+        || snapshot.carryCount < 0 || snapshot.carryCount > DelayLineSnapshot::kMaxCarry)
+        return false;
+    snapshot.noisePosition = (static_cast<uint64>(static_cast<uint32>(noiseHi)) << 32) | static_cast<uint32>(noiseLo);
+    for (int i = 0; i < DelayLineSnapshot::kMaxCarry; ++i)
+    {
+        if (!reader.readFloat(snapshot.carryL[i]) || !reader.readFloat(snapshot.carryR[i]))
+            return false;
+    }
+    
+    // Snapshots written before the quality tiers have no cubic history
+    bool hasHistory = reader.remaining() >= DelayLineSnapshot::kNumResamplers * 8;
+    for (int i = 0; i < DelayLineSnapshot::kNumResamplers; ++i)
+    {
+        snapshot.resamplerPrev1[i] = 0.0f;
+        snapshot.resamplerPrev2[i] = 0.0f;
+        if (hasHistory && (!reader.readFloat(snapshot.resamplerPrev1[i]) || !reader.readFloat(snapshot.resamplerPrev2[i])))
+            return false;
+    }
+    
+    // Snapshots written before the rate was selectable are at 24 kHz
+    snapshot.internalSampleRate = DelayBuffer::INTERNAL_RATES[DelayBuffer::DEFAULT_INTERNAL_RATE];
+    if (reader.remaining() >= 8 && !reader.readDouble(snapshot.internalSampleRate))
+        return false;
+    return true;
+}
+
+//------------------------------------------------------------------------
+// Processor chunk helpers
+//------------------------------------------------------------------------
+bool writeWetDelayState(IBStream* stream, const WetDelayStateData& data)
+{
+    StateWriter writer(stream);
+    if (!writer.begin()
+        || !writer.writeInt32Field(StateFormat::kFieldDelayIndex, data.delayIndex)
+        || !writer.writeInt32Field(StateFormat::kFieldRecall, data.recall)
+        || !writer.writeInt32Field(StateFormat::kFieldLineStorage, data.lineStorage)
+        || !writer.writeInt32Field(StateFormat::kFieldQuality, data.quality)
+        || !writer.writeInt32Field(StateFormat::kFieldDelayMultiplier, data.delayMultiplier)
+        || !writer.writeInt32Field(StateFormat::kFieldBitDepth, data.bitDepth)
+        || !writer.writeInt32Field(StateFormat::kFieldInternalRate, data.internalRate)
+        || !writer.writeInt32Field(StateFormat::kFieldBypass, data.bypass)
+        || !writer.beginField(StateFormat::kFieldNoiseSeed, 8)
+        || !writer.writeInt32(static_cast<int32>(data.noiseSeed))
+        || !writer.writeInt32(static_cast<int32>(data.noiseSeed >> 32)))
+        return false;
+    
+    if (data.snapshot && !writeSnapshot(writer, *data.snapshot))
+        return false;
+    
+    return writer.finish();
+}
+
+//------------------------------------------------------------------------
+bool readWetDelayState(IBStream* stream, WetDelayStateData& data)
+{
+    StateReader reader(stream);
+    WetDelayStateData parsed = data;
+    parsed.snapshotLoaded = false;
+
+    int32 legacyValue = 0;
+    switch (reader.open(legacyValue))
+    {
+        case StateReader::Format::Invalid:
+            return false;
+
+        case StateReader::Format::Legacy:
+            if (legacyValue < 0 || legacyValue >= kNumDelayTimes)
+                return false;
+            data.delayIndex = legacyValue;
+            data.snapshotLoaded = false;
+            return true;
+
+        case StateReader::Format::Versioned:
+            break;
+    }
+
+    uint32 id, length;
+    while (reader.nextField(id, length))
+    {
+        switch (id)
+        {
+            case StateFormat::kFieldDelayIndex:
+                if (!reader.readInt32(parsed.delayIndex))
+                    return false;
+                break;
+
+            case StateFormat::kFieldRecall:
+                if (!reader.readInt32(parsed.recall))
+                    return false;
+                break;
+
+            case StateFormat::kFieldLineStorage:
+                if (!reader.readInt32(parsed.lineStorage))
+                    return false;
+                break;
+
+            case StateFormat::kFieldQuality:
+                if (!reader.readInt32(parsed.quality))
+                    return false;
+                break;
+
+            case StateFormat::kFieldDelayMultiplier:
+                if (!reader.readInt32(parsed.delayMultiplier))
+                    return false;
+                break;
+
+            case StateFormat::kFieldBitDepth:
+                if (!reader.readInt32(parsed.bitDepth))
+                    return false;
+                break;
+
+            case StateFormat::kFieldInternalRate:
+                if (!reader.readInt32(parsed.internalRate))
+                    return false;
+                break;
+
+            case StateFormat::kFieldBypass:
+                if (!reader.readInt32(parsed.bypass))
+                    return false;
+                break;
+
+            case StateFormat::kFieldNoiseSeed:
+            {
+                int32 lo = 0, hi = 0;
+                if (!reader.readInt32(lo) || !reader.readInt32(hi))
+                    return false;
+                parsed.noiseSeed = (static_cast<uint64>(static_cast<uint32>(hi)) << 32) | static_cast<uint32>(lo);
+                break;
+            }
+
+            case StateFormat::kFieldDelaySnapshot:
+                // Skipped by nextField if the caller has no target
+                if (parsed.snapshot)
+                {
+                    if (!readSnapshot(reader, *parsed.snapshot))
+                        return false;
+                    parsed.snapshotLoaded = true;
+                }
+                break;
+
+            default:
+                // Unknown field from a newer version - skipped by nextField
+                break;
+        }
+    }
+
+    if (!reader.finish())
+        return false;
+
+    // Validate before anything reaches the processor
+    if (parsed.delayIndex < 0 || parsed.delayIndex >= kNumDelayTimes)
+        return false;
+    if (parsed.recall != 0 && parsed.recall != 1)
+        return false;
+    if (parsed.lineStorage != 0 && parsed.lineStorage != 1)
+        return false;
+    if (parsed.quality < 0 || parsed.quality >= kNumQualityModes)
+        return false;
+    if (parsed.delayMultiplier < 0 || parsed.delayMultiplier >= kNumDelayMultipliers)
+        return false;
+    if (parsed.bitDepth < kMinBitDepth || parsed.bitDepth >= kMinBitDepth + kNumBitDepths)
+        return false;
+    if (parsed.internalRate < 0 || parsed.internalRate >= kNumInternalRates)
+        return false;
+    if (parsed.bypass != 0 && parsed.bypass != 1)
+        return false;
+
+    data = parsed;
+    return true;
+}
+
+//------------------------------------------------------------------------
+} // namespace Yonie
@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------
+// Copyright(c) 2026 Yonie.
+//------------------------------------------------------------------------
+
+#pragma once
+
+#include "pluginterfaces/base/ibstream.h"
+#include "base/source/fstreamer.h"
+#include "delaybuffer.h"
+
+namespace Yonie {
+
+//------------------------------------------------------------------------
+// State chunk layout (little endian)
+//
+//   uint32 magic 'WDLY'
+//   uint32 format version
+//   { uint32 fieldId, uint32 length, <length bytes> } ...
+//   uint32 kFieldEnd, uint32 4, uint32 checksum
+//
+// The checksum is FNV-1a over every byte between the magic and the end
+// field. Readers skip fields they do not know and only read the prefix of
+// fields that grew in a later version, so old builds can load new chunks.
+// Chunks written before 1.2 hold a single int32 delay index; the first
+// word distinguishes the two since the magic is never a valid index.
+//------------------------------------------------------------------------
+namespace StateFormat {
+
+static constexpr Steinberg::uint32 kMagic = 0x594C4457; // "WDLY"
+static constexpr Steinberg::uint32 kVersion = 1;
+
+enum FieldId : Steinberg::uint32
+{
+    kFieldEnd = 0,
+    kFieldDelayIndex = 1,   // int32, 0-5
+    kFieldRecall = 2,       // int32, 0/1 - store delay line with the session
+    kFieldDelaySnapshot = 3,// DelayLineSnapshot, see wetdelaystate.cpp
+    kFieldNoiseSeed = 4,    // uint64 as two words (low first)
+    kFieldLineStorage = 5,  // int32, 0 = float, 1 = 12-bit packed
+    kFieldQuality = 6,      // int32, 0-3 = eco, standard, high, auto
+    kFieldDelayMultiplier = 7,// int32, 0-4 = x1, x2, x5, x10, x25
+    kFieldBitDepth = 8,     // int32, 8-16 bits
+    kFieldInternalRate = 9, // int32, 0-3 = 16, 24, 32, 48 kHz
+    kFieldBypass = 10       // int32, 0/1
+};
+
+// Fields of the controller chunk (same framing, separate stream)
+enum ControllerFieldId : Steinberg::uint32
+{
+    kFieldMeterRefresh = 1  // int32, 0-1 = 30, 60 fps
+};
+
+// Upper bound on a stored line, checked before resizing for a snapshot
+static constexpr Steinberg::uint32 kMaxSnapshotSamples = 1 << 20;
+
+} // namespace StateFormat
+
+//------------------------------------------------------------------------
+// WetDelayStateData - Plain values carried by the processor state chunk
+//------------------------------------------------------------------------
+struct WetDelayStateData
+{
+    Steinberg::int32 delayIndex = 0;
+    Steinberg::int32 recall = 0;
+    Steinberg::int32 lineStorage = 0;
+    Steinberg::int32 quality = 1;
+    Steinberg::int32 delayMultiplier = 0;
+    Steinberg::int32 bitDepth = DelayBuffer::DEFAULT_BIT_DEPTH;
+    Steinberg::int32 internalRate = DelayBuffer::DEFAULT_INTERNAL_RATE;
+    Steinberg::int32 bypass = 0;
+    Steinberg::uint64 noiseSeed = 0;
+    
+    // Writing: stored if non-null. Reading: decode target, or nullptr to
+    // skip the field; snapshotLoaded is only set if the whole chunk is valid.
+    DelayLineSnapshot* snapshot = nullptr;
+    bool snapshotLoaded = false;
+};
+
+//------------------------------------------------------------------------
+// StateWriter - Streams length-prefixed fields with a running checksum
+//------------------------------------------------------------------------
+class StateWriter
+{
+public:
+    explicit StateWriter(Steinberg::IBStream* stream);
+
+    // Write magic and version
+    bool begin();
+
+    // Write a complete field
+    bool writeInt32Field(Steinberg::uint32 id, Steinberg::int32 value);
+
+    // Write a field header followed by raw payload writes (length must match)
+    bool beginField(Steinberg::uint32 id, Steinberg::uint32 length);
+    bool writeInt32(Steinberg::int32 value);
+    bool writeFloat(float value);
+    bool writeDouble(double value);
+    bool writeBytes(const void* data, Steinberg::uint32 size);
+
+    // Write the end marker and checksum
+    bool finish();
+
+private:
+    bool writeWord(Steinberg::uint32 value);
+
+    Steinberg::IBStreamer streamer;
+    Steinberg::uint32 checksum;
+    bool ok;
+};
+
+//------------------------------------------------------------------------
+// StateReader - Parses a chunk field by field without allocating
+//------------------------------------------------------------------------
+class StateReader
+{
+public:
+    enum class Format { Invalid, Legacy, Versioned };
+
+    explicit StateReader(Steinberg::IBStream* stream);
+
+    // Read the first word. Legacy chunks return their int32 in legacyValue.
+    Format open(Steinberg::int32& legacyValue);
+
+    // Advance to the next field. Returns false at the end marker or on error;
+    // any unread bytes of the previous field are skipped first.
+    bool nextField(Steinberg::uint32& id, Steinberg::uint32& length);
+
+    // Typed reads within the current field
+    bool readInt32(Steinberg::int32& value);
+    bool readFloat(float& value);
+    bool readDouble(double& value);
+    bool readBytes(void* data, Steinberg::uint32 size);
+
+    // Bytes left in the current field
+    Steinberg::uint32 remaining() const { return fieldRemaining; }
+
+    // True if the end marker was reached and the checksum matched
+    bool finish();
+
+private:
+    bool readWord(Steinberg::uint32& value);
+    bool readHeaderWord(Steinberg::uint32& value);
+    bool skip(Steinberg::uint32 size);
+
+    Steinberg::IBStreamer streamer;
+    Steinberg::uint32 checksum;
+    Steinberg::uint32 fieldRemaining;
+    bool reachedEnd;
+    bool ok;
+};
+
+//------------------------------------------------------------------------
+// Processor chunk helpers shared by processor and controller.
+// readWetDelayState only updates 'data' if the whole chunk is valid.
+//------------------------------------------------------------------------
+bool writeWetDelayState(Steinberg::IBStream* stream, const WetDelayStateData& data);
+bool readWetDelayState(Steinberg::IBStream* stream, WetDelayStateData& data);
+
+//------------------------------------------------------------------------
+} // namespace Yonie